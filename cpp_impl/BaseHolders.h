@@ -15,7 +15,13 @@
 #include "ScopedResource.h"
 #include <string>
 #include <map>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <array>
 #include <memory>
+#include <future>
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <thread>
@@ -24,6 +30,20 @@ namespace milvus {
 namespace engine {
 namespace snapshot {
 
+struct ResourceHolderStats {
+    size_t capacity = 0;
+    size_t bytes = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+};
+
+// Cache of the resources in use, split into stripes by id so that lookups of different ids
+// rarely share a lock. A miss is loaded outside the lock, and concurrent misses of the same id
+// wait for the one load already in flight instead of starting their own.
+// With a capacity set, each stripe keeps its share of it by evicting the least recently used
+// resources nobody references. Referenced resources are never evicted, so a holder may stay
+// over capacity while they are in use
 template <typename ResourceT, typename Derived>
 class ResourceHolder {
 public:
@@ -31,12 +51,11 @@ public:
     /* using ResourcePtr = typename ResourceT::Ptr; */
     using ScopedT = ScopedResource<ResourceT>;
     using ScopedPtr = std::shared_ptr<ScopedT>;
-    using IdMapT = std::map<ID_TYPE, ResourcePtr>;
     using Ptr = std::shared_ptr<Derived>;
     ScopedT GetResource(ID_TYPE id, bool scoped = true);
-
-    bool AddNoLock(ResourcePtr resource);
-    bool ReleaseNoLock(ID_TYPE id);
+    // One result per id, in order, empty where there is none. All misses that no other thread
+    // is loading are loaded by one batched operation
+    std::vector<ScopedT> GetResources(const IDS_TYPE& ids, bool scoped = true);
 
     virtual bool Add(ResourcePtr resource);
     virtual bool Release(ID_TYPE id);
@@ -47,18 +66,71 @@ public:
         return holder;
     }
 
+    // In bytes as estimated by GetMemorySize. 0, the default, never evicts
+    void SetCapacity(size_t capacity);
+    size_t GetCapacity() const { return capacity_; }
+    ResourceHolderStats GetStats() const;
+
     virtual void Dump(const std::string& tag = "");
 
 protected:
+    static constexpr size_t STRIPE_NUM = 16;
+    // Entries looked at by one eviction pass at most, so that a stripe full of referenced
+    // resources does not turn every add into a full scan
+    static constexpr size_t EVICT_SCAN_NUM = 32;
+
+    struct Entry {
+        ResourcePtr resource_;
+        size_t bytes_;
+        std::list<ID_TYPE>::iterator lru_pos_;
+    };
+    using IdMapT = std::unordered_map<ID_TYPE, Entry>;
+
+    struct Stripe {
+        std::mutex mutex_;
+        IdMapT id_map_;
+        // Most recently used first
+        std::list<ID_TYPE> lru_;
+        size_t bytes_ = 0;
+        // Loads in flight, keyed by id
+        std::unordered_map<ID_TYPE, std::shared_future<ResourcePtr>> loading_;
+    };
+
+    Stripe& GetStripe(ID_TYPE id) { return stripes_[static_cast<size_t>(id) % STRIPE_NUM]; }
+
+    // Require the lock of the resource's stripe
+    ResourcePtr FindNoLock(Stripe& stripe, ID_TYPE id);
+    bool AddNoLock(Stripe& stripe, ResourcePtr resource);
+    ResourcePtr RemoveNoLock(Stripe& stripe, ID_TYPE id);
+    // Evict until the stripe is within its share of the capacity. The most recently used
+    // resource stays
+    void EvictNoLock(Stripe& stripe);
+
+    // Queues the hard delete of the resource. Queued deletes are applied by FlushHardDeletes on
+    // the reclaimer, in batches of one operation each
     virtual void OnNoRefCallBack(ResourcePtr resource);
+    void FlushHardDeletes();
+    // Called with the stripe lock held
+    virtual void OnEvicted(ResourcePtr) {}
 
+    // Load a resource missing from the holder, without adding it. Called without any lock held
     virtual ResourcePtr Load(ID_TYPE id);
     virtual ResourcePtr Load(const std::string& name);
+    // One result per id, in order
+    virtual std::vector<ResourcePtr> Load(const IDS_TYPE& ids);
     ResourceHolder() = default;
     virtual ~ResourceHolder() = default;
 
-    std::mutex mutex_;
-    IdMapT id_map_;
+    std::array<Stripe, STRIPE_NUM> stripes_;
+
+    std::mutex delete_mutex_;
+    IDS_TYPE pending_deletes_;
+
+    std::atomic<size_t> capacity_ = 0;
+    std::atomic<size_t> bytes_ = 0;
+    std::atomic<size_t> hits_ = 0;
+    std::atomic<size_t> misses_ = 0;
+    std::atomic<size_t> evictions_ = 0;
 };
 
 } // snapshot
@@ -11,7 +11,9 @@
 
 #include "BaseHolders.h"
 #include "Operations.h"
+#include "Reclaimer.h"
 #include <iostream>
+#include <map>
 #include <memory>
 
 namespace milvus {
@@ -20,15 +22,44 @@ namespace snapshot {
 
 template <typename ResourceT, typename Derived>
 void ResourceHolder<ResourceT, Derived>::Dump(const std::string& tag) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    std::cout << typeid(*this).name() << " Dump Start [" << tag <<  "]:" << id_map_.size() << std::endl;
-    for (auto& kv : id_map_) {
+    std::map<ID_TYPE, ResourcePtr> resources;
+    for (auto& stripe : stripes_) {
+        std::unique_lock<std::mutex> lock(stripe.mutex_);
+        for (auto& kv : stripe.id_map_) {
+            resources.emplace(kv.first, kv.second.resource_);
+        }
+    }
+    auto stats = GetStats();
+    std::cout << typeid(*this).name() << " Dump Start [" << tag <<  "]:" << resources.size();
+    std::cout << " bytes=" << stats.bytes << "/" << stats.capacity << " hits=" << stats.hits;
+    std::cout << " misses=" << stats.misses << " evictions=" << stats.evictions << std::endl;
+    for (auto& kv : resources) {
         /* std::cout << "\t" << kv.second->ToString() << std::endl; */
         std::cout << "\t" << kv.first << " RefCnt " << kv.second->RefCnt() << std::endl;
     }
     std::cout << typeid(*this).name() << " Dump   End [" << tag <<  "]" << std::endl;
 }
 
+template <typename ResourceT, typename Derived>
+void ResourceHolder<ResourceT, Derived>::SetCapacity(size_t capacity) {
+    capacity_ = capacity;
+    for (auto& stripe : stripes_) {
+        std::unique_lock<std::mutex> lock(stripe.mutex_);
+        EvictNoLock(stripe);
+    }
+}
+
+template <typename ResourceT, typename Derived>
+ResourceHolderStats ResourceHolder<ResourceT, Derived>::GetStats() const {
+    ResourceHolderStats stats;
+    stats.capacity = capacity_;
+    stats.bytes = bytes_;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.evictions = evictions_;
+    return stats;
+}
+
 template <typename ResourceT, typename Derived>
 typename ResourceHolder<ResourceT, Derived>::ResourcePtr
 ResourceHolder<ResourceT, Derived>::Load(ID_TYPE id) {
@@ -36,12 +67,7 @@ ResourceHolder<ResourceT, Derived>::Load(ID_TYPE id) {
     context.id = id;
     auto op = std::make_shared<LoadOperation<ResourceT>>(context);
     op->Push();
-    auto c = op->GetResource();
-    if (c) {
-        AddNoLock(c);
-        return c;
-    }
-    return nullptr;
+    return op->GetResource();
 }
 
 template <typename ResourceT, typename Derived>
@@ -50,41 +76,232 @@ ResourceHolder<ResourceT, Derived>::Load(const std::string& name) {
     return nullptr;
 }
 
+template <typename ResourceT, typename Derived>
+std::vector<typename ResourceHolder<ResourceT, Derived>::ResourcePtr>
+ResourceHolder<ResourceT, Derived>::Load(const IDS_TYPE& ids) {
+    LoadOperationContext context;
+    context.ids = ids;
+    auto op = std::make_shared<LoadResourcesOperation<ResourceT>>(context);
+    op->Push();
+    auto& resources = op->GetResources();
+    if (resources.size() != ids.size()) return std::vector<ResourcePtr>(ids.size());
+    return std::vector<ResourcePtr>(resources.begin(), resources.end());
+}
+
+template <typename ResourceT, typename Derived>
+std::vector<typename ResourceHolder<ResourceT, Derived>::ScopedT>
+ResourceHolder<ResourceT, Derived>::GetResources(const IDS_TYPE& ids, bool scoped) {
+    std::vector<ScopedT> results(ids.size());
+    // Positions in `ids` of each id that missed
+    std::map<ID_TYPE, std::vector<size_t>> missing;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        auto& stripe = GetStripe(ids[i]);
+        std::unique_lock<std::mutex> lock(stripe.mutex_);
+        auto ret = FindNoLock(stripe, ids[i]);
+        if (ret) {
+            results[i] = ScopedT(ret, scoped);
+            ++hits_;
+        } else {
+            missing[ids[i]].push_back(i);
+        }
+    }
+    if (missing.empty()) return results;
+
+    // Claim the misses nobody is loading yet. The others are waited for one by one below
+    IDS_TYPE load_ids;
+    std::vector<std::promise<ResourcePtr>> promises;
+    IDS_TYPE wait_ids;
+    for (auto& kv : missing) {
+        auto& stripe = GetStripe(kv.first);
+        std::unique_lock<std::mutex> lock(stripe.mutex_);
+        if (stripe.loading_.find(kv.first) != stripe.loading_.end()) {
+            wait_ids.push_back(kv.first);
+            continue;
+        }
+        promises.emplace_back();
+        stripe.loading_.emplace(kv.first, promises.back().get_future().share());
+        load_ids.push_back(kv.first);
+    }
+
+    misses_ += load_ids.size();
+    std::vector<ResourcePtr> loaded;
+    try {
+        if (!load_ids.empty()) loaded = Load(load_ids);
+    } catch (...) {
+        // Hand the failure to the waiters and let the next caller retry
+        for (size_t i = 0; i < load_ids.size(); ++i) {
+            auto& stripe = GetStripe(load_ids[i]);
+            std::unique_lock<std::mutex> lock(stripe.mutex_);
+            stripe.loading_.erase(load_ids[i]);
+            promises[i].set_exception(std::current_exception());
+        }
+        throw;
+    }
+    for (size_t i = 0; i < load_ids.size(); ++i) {
+        auto id = load_ids[i];
+        auto& stripe = GetStripe(id);
+        std::unique_lock<std::mutex> lock(stripe.mutex_);
+        stripe.loading_.erase(id);
+        auto ret = loaded[i];
+        promises[i].set_value(ret);
+        if (!ret) continue;
+        if (!AddNoLock(stripe, ret)) ret = FindNoLock(stripe, id);
+        for (auto pos : missing[id]) {
+            results[pos] = ScopedT(ret, scoped);
+        }
+    }
+
+    for (auto id : wait_ids) {
+        auto ret = GetResource(id, scoped);
+        for (auto pos : missing[id]) {
+            results[pos] = ret;
+        }
+    }
+    return results;
+}
+
 template <typename ResourceT, typename Derived>
 typename ResourceHolder<ResourceT, Derived>::ScopedT
 ResourceHolder<ResourceT, Derived>::GetResource(ID_TYPE id, bool scoped) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    auto cit = id_map_.find(id);
-    if (cit == id_map_.end()) {
-        auto ret = Load(id);
+    auto& stripe = GetStripe(id);
+    while (true) {
+        std::promise<ResourcePtr> promise;
+        std::shared_future<ResourcePtr> loading;
+        {
+            std::unique_lock<std::mutex> lock(stripe.mutex_);
+            auto ret = FindNoLock(stripe, id);
+            if (ret) {
+                ++hits_;
+                return ScopedT(ret, scoped);
+            }
+            auto lit = stripe.loading_.find(id);
+            if (lit != stripe.loading_.end()) {
+                loading = lit->second;
+            } else {
+                stripe.loading_.emplace(id, promise.get_future().share());
+            }
+        }
+
+        if (loading.valid()) {
+            // Another thread is loading it. Look it up again once it is done: it may have been
+            // released in the meantime
+            if (!loading.get()) return ScopedT();
+            continue;
+        }
+
+        ++misses_;
+        ResourcePtr ret;
+        try {
+            ret = Load(id);
+        } catch (...) {
+            // Hand the failure to the waiters and let the next caller retry
+            std::unique_lock<std::mutex> lock(stripe.mutex_);
+            stripe.loading_.erase(id);
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+        std::unique_lock<std::mutex> lock(stripe.mutex_);
+        stripe.loading_.erase(id);
+        promise.set_value(ret);
         if (!ret) return ScopedT();
+        // Keep what was added while loading, if anything
+        if (!AddNoLock(stripe, ret)) ret = FindNoLock(stripe, id);
         return ScopedT(ret, scoped);
     }
-    return ScopedT(cit->second, scoped);
 }
 
 template <typename ResourceT, typename Derived>
 void
 ResourceHolder<ResourceT, Derived>::OnNoRefCallBack(typename ResourceHolder<ResourceT, Derived>::ResourcePtr resource) {
-    HardDelete(resource->GetID());
-    Release(resource->GetID());
+    bool flush;
+    {
+        std::unique_lock<std::mutex> lock(delete_mutex_);
+        flush = pending_deletes_.empty();
+        pending_deletes_.push_back(resource->GetID());
+    }
+    // Whatever is queued to the reclaimer ahead of the flush joins its batch
+    if (flush) Reclaimer::GetInstance().Submit([this]() { FlushHardDeletes(); });
 }
 
 template <typename ResourceT, typename Derived>
-bool ResourceHolder<ResourceT, Derived>::ReleaseNoLock(ID_TYPE id) {
-    auto it = id_map_.find(id);
-    if (it == id_map_.end()) {
-        return false;
+void
+ResourceHolder<ResourceT, Derived>::FlushHardDeletes() {
+    IDS_TYPE ids;
+    {
+        std::unique_lock<std::mutex> lock(delete_mutex_);
+        ids.swap(pending_deletes_);
     }
+    Reclaimer::GetInstance().HardDeleteInBatches(ids, [this](const IDS_TYPE& batch) -> size_t {
+        IDS_TYPE unused;
+        for (auto id : batch) {
+            auto& stripe = GetStripe(id);
+            std::unique_lock<std::mutex> lock(stripe.mutex_);
+            // Referenced again since it was queued. It is queued anew once that reference is gone
+            auto it = stripe.id_map_.find(id);
+            if (it != stripe.id_map_.end() && it->second.resource_->RefCnt() > 0) continue;
+            RemoveNoLock(stripe, id);
+            unused.push_back(id);
+        }
+        if (unused.empty()) return 0;
+        auto op = std::make_shared<HardDeleteOperation<ResourceT>>(unused);
+        op->Push();
+        return unused.size();
+    });
+}
 
-    id_map_.erase(it);
-    return true;
+template <typename ResourceT, typename Derived>
+typename ResourceHolder<ResourceT, Derived>::ResourcePtr
+ResourceHolder<ResourceT, Derived>::FindNoLock(Stripe& stripe, ID_TYPE id) {
+    auto it = stripe.id_map_.find(id);
+    if (it == stripe.id_map_.end()) {
+        return nullptr;
+    }
+
+    stripe.lru_.splice(stripe.lru_.begin(), stripe.lru_, it->second.lru_pos_);
+    return it->second.resource_;
+}
+
+template <typename ResourceT, typename Derived>
+typename ResourceHolder<ResourceT, Derived>::ResourcePtr
+ResourceHolder<ResourceT, Derived>::RemoveNoLock(Stripe& stripe, ID_TYPE id) {
+    auto it = stripe.id_map_.find(id);
+    if (it == stripe.id_map_.end()) {
+        return nullptr;
+    }
+
+    auto resource = it->second.resource_;
+    stripe.lru_.erase(it->second.lru_pos_);
+    stripe.bytes_ -= it->second.bytes_;
+    bytes_ -= it->second.bytes_;
+    stripe.id_map_.erase(it);
+    return resource;
+}
+
+template <typename ResourceT, typename Derived>
+void ResourceHolder<ResourceT, Derived>::EvictNoLock(Stripe& stripe) {
+    size_t capacity = capacity_;
+    if (capacity == 0) return;
+    auto budget = capacity / STRIPE_NUM;
+    for (size_t scanned = 0; stripe.bytes_ > budget && scanned < EVICT_SCAN_NUM
+            && stripe.lru_.size() > 1; ++scanned) {
+        auto id = stripe.lru_.back();
+        auto& entry = stripe.id_map_.at(id);
+        if (entry.resource_->RefCnt() > 0) {
+            // In use: give it another round instead of looking at it again on the next pass
+            stripe.lru_.splice(stripe.lru_.begin(), stripe.lru_, entry.lru_pos_);
+            continue;
+        }
+        auto resource = RemoveNoLock(stripe, id);
+        ++evictions_;
+        OnEvicted(resource);
+    }
 }
 
 template <typename ResourceT, typename Derived>
 bool ResourceHolder<ResourceT, Derived>::Release(ID_TYPE id) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    return ReleaseNoLock(id);
+    auto& stripe = GetStripe(id);
+    std::unique_lock<std::mutex> lock(stripe.mutex_);
+    return RemoveNoLock(stripe, id) != nullptr;
 }
 
 template <typename ResourceT, typename Derived>
@@ -96,21 +313,37 @@ ResourceHolder<ResourceT, Derived>::HardDelete(ID_TYPE id) {
 }
 
 template <typename ResourceT, typename Derived>
-bool ResourceHolder<ResourceT, Derived>::AddNoLock(typename ResourceHolder<ResourceT, Derived>::ResourcePtr resource) {
+bool ResourceHolder<ResourceT, Derived>::AddNoLock(Stripe& stripe,
+        typename ResourceHolder<ResourceT, Derived>::ResourcePtr resource) {
     if (!resource) return false;
-    if (id_map_.find(resource->GetID()) != id_map_.end()) {
+    if (stripe.id_map_.find(resource->GetID()) != stripe.id_map_.end()) {
         return false;
     }
 
-    id_map_[resource->GetID()] = resource;
-    resource->RegisterOnNoRefCB(std::bind(&Derived::OnNoRefCallBack, this, resource));
+    auto bytes = resource->GetMemorySize();
+    stripe.lru_.push_front(resource->GetID());
+    stripe.id_map_.emplace(resource->GetID(), Entry{resource, bytes, stripe.lru_.begin()});
+    stripe.bytes_ += bytes;
+    bytes_ += bytes;
+    // Committed resources are shared with the store, so an evicted one may come back as the same
+    // object. It keeps its callback, which holds it weakly so as not to keep it alive
+    if (!resource->HasOnNoRefCB()) {
+        std::weak_ptr<ResourceT> weak = resource;
+        resource->RegisterOnNoRefCB([this, weak]() {
+            auto resource = weak.lock();
+            if (resource) OnNoRefCallBack(resource);
+        });
+    }
+    EvictNoLock(stripe);
     return true;
 }
 
 template <typename ResourceT, typename Derived>
 bool ResourceHolder<ResourceT, Derived>::Add(typename ResourceHolder<ResourceT, Derived>::ResourcePtr resource) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    return AddNoLock(resource);
+    if (!resource) return false;
+    auto& stripe = GetStripe(resource->GetID());
+    std::unique_lock<std::mutex> lock(stripe.mutex_);
+    return AddNoLock(stripe, resource);
 }
 
 } // snapshot
@@ -12,6 +12,7 @@
 #pragma once
 #include "ReferenceProxy.h"
 #include <string>
+#include <cstddef>
 
 namespace milvus {
 namespace engine {
@@ -25,9 +26,23 @@ public:
 
     virtual std::string ToString() const;
 
+    // Estimated bytes in memory: the object plus what its fields allocate, as reported by the
+    // fields that have a GetHeapSize()
+    size_t GetMemorySize() const;
+
     virtual ~DBBaseResource() {}
 };
 
+template <typename Field>
+auto FieldHeapSize(const Field& field, int) -> decltype(field.GetHeapSize()) {
+    return field.GetHeapSize();
+}
+
+template <typename Field>
+size_t FieldHeapSize(const Field&, long) {
+    return 0;
+}
+
 template <typename ...Fields>
 DBBaseResource<Fields...>::DBBaseResource(const Fields&... fields) : Fields(fields)... {
     /* InstallField("id"); */
@@ -36,6 +51,11 @@ DBBaseResource<Fields...>::DBBaseResource(const Fields&... fields) : Fields(fiel
     /* std::vector<std::string> attrs = {Fields::ATTR...}; */
 }
 
+template <typename ...Fields>
+size_t DBBaseResource<Fields...>::GetMemorySize() const {
+    return sizeof(*this) + (FieldHeapSize<Fields>(*this, 0) + ... + 0);
+}
+
 template <typename ...Fields>
 std::string DBBaseResource<Fields...>::ToString() const {
 }
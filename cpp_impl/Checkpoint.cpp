@@ -0,0 +1,344 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include "Checkpoint.h"
+#include "WriteAheadLog.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+static bool
+WriteAll(int fd, const char* data, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        auto n = ::write(fd, data + written, size - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        written += n;
+    }
+    return true;
+}
+
+bool
+CheckpointFile::SyncParentDir(const std::string& path) {
+    std::vector<char> buf(path.begin(), path.end());
+    buf.push_back('\0');
+    auto fd = ::open(dirname(buf.data()), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return false;
+    auto ok = fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+bool
+CheckpointFile::Write(const std::string& path, const std::string& payload, size_t index_size) {
+    std::string header;
+    uint32_t magic = MAGIC, version = VERSION;
+    uint64_t size = payload.size(), checked_size = std::min(index_size, payload.size());
+    uint32_t crc = WriteAheadLog::Crc32(payload.data(), checked_size);
+    header.append(reinterpret_cast<const char*>(&magic), sizeof(magic));
+    header.append(reinterpret_cast<const char*>(&version), sizeof(version));
+    header.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    header.append(reinterpret_cast<const char*>(&checked_size), sizeof(checked_size));
+    header.append(reinterpret_cast<const char*>(&crc), sizeof(crc));
+
+    auto tmp_path = path + ".tmp";
+    auto fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to create checkpoint " << tmp_path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    auto ok = WriteAll(fd, header.data(), header.size()) && WriteAll(fd, payload.data(), payload.size())
+        && fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || ::rename(tmp_path.c_str(), path.c_str()) != 0 || !SyncParentDir(path)) {
+        std::cerr << "Failed to write checkpoint " << path << ": " << strerror(errno) << std::endl;
+        ::unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+static const size_t ENTRY_SIZE = 5 * sizeof(uint64_t);
+static const size_t PARENT_ENTRY_SIZE = 2 * sizeof(uint64_t);
+static const size_t SECTION_SIZE = 4 * sizeof(uint64_t);
+
+template <typename T>
+static void
+Append(std::string& buffer, T value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// The mapped payload is not aligned, read values by copy
+template <typename T>
+static T
+Load(const char* data) {
+    T value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+CheckpointImageBuilder::CheckpointImageBuilder(size_t type_num)
+    : max_ids_(type_num, 0), entries_(type_num) {
+}
+
+void
+CheckpointImageBuilder::SetMaxId(size_t type, ID_TYPE id) {
+    max_ids_[type] = id;
+}
+
+void
+CheckpointImageBuilder::Add(size_t type, ID_TYPE id, ID_TYPE parent_id, const char* data, size_t size) {
+    entries_[type].push_back({id, parent_id, records_.size(), size, WriteAheadLog::Crc32(data, size)});
+    records_.append(data, size);
+}
+
+size_t
+CheckpointImageBuilder::IndexSize() const {
+    return max_ids_.size() * (sizeof(ID_TYPE) + SECTION_SIZE);
+}
+
+std::string
+CheckpointImageBuilder::Finish() {
+    auto type_num = max_ids_.size();
+    uint64_t records_offset = IndexSize();
+
+    std::string tables;
+    std::vector<uint64_t> entries_offsets, parents_offsets, tables_crcs;
+    for (auto& entries : entries_) {
+        std::sort(entries.begin(), entries.end(), [](const Entry& l, const Entry& r) { return l.id < r.id; });
+        auto tables_begin = tables.size();
+        entries_offsets.push_back(records_offset + records_.size() + tables.size());
+        for (auto& e : entries) {
+            Append(tables, e.id);
+            Append(tables, e.parent_id);
+            Append(tables, records_offset + e.offset);
+            Append(tables, e.size);
+            Append<uint64_t>(tables, e.crc);
+        }
+
+        std::vector<std::pair<ID_TYPE, ID_TYPE>> parents;
+        parents.reserve(entries.size());
+        for (auto& e : entries) {
+            parents.emplace_back(e.parent_id, e.id);
+        }
+        std::sort(parents.begin(), parents.end());
+        parents_offsets.push_back(records_offset + records_.size() + tables.size());
+        for (auto& p : parents) {
+            Append(tables, p.first);
+            Append(tables, p.second);
+        }
+        tables_crcs.push_back(WriteAheadLog::Crc32(tables.data() + tables_begin, tables.size() - tables_begin));
+    }
+
+    std::string payload;
+    payload.reserve(records_offset + records_.size() + tables.size());
+    for (auto id : max_ids_) {
+        Append(payload, id);
+    }
+    for (size_t i = 0; i < type_num; ++i) {
+        Append<uint64_t>(payload, entries_[i].size());
+        Append(payload, entries_offsets[i]);
+        Append(payload, parents_offsets[i]);
+        Append(payload, tables_crcs[i]);
+    }
+    payload.append(records_);
+    payload.append(tables);
+    return payload;
+}
+
+CheckpointImage::~CheckpointImage() {
+    if (map_) {
+        munmap(map_, map_size_);
+    }
+}
+
+CheckpointImage::Ptr
+CheckpointImage::Open(const std::string& path, size_t type_num, bool& corrupted) {
+    corrupted = false;
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    Ptr image(new CheckpointImage());
+    image->type_num_ = type_num;
+    image->checks_.reset(new SectionCheck[type_num]);
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        auto map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            image->map_ = map;
+            image->map_size_ = st.st_size;
+        }
+    }
+    ::close(fd);
+
+    if (!image->Validate()) {
+        std::cerr << "Checkpoint " << path << " is corrupted" << std::endl;
+        corrupted = true;
+        return nullptr;
+    }
+    return image;
+}
+
+bool
+CheckpointImage::Validate() {
+    if (!map_ || map_size_ < CheckpointFile::HEADER_SIZE) return false;
+    auto data = static_cast<const char*>(map_);
+    auto magic = Load<uint32_t>(data);
+    auto version = Load<uint32_t>(data + sizeof(uint32_t));
+    auto size = Load<uint64_t>(data + 2 * sizeof(uint32_t));
+    auto index_size = Load<uint64_t>(data + 2 * sizeof(uint32_t) + sizeof(uint64_t));
+    auto crc = Load<uint32_t>(data + 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t));
+    if (magic != CheckpointFile::MAGIC || version != CheckpointFile::VERSION) return false;
+    if (map_size_ - CheckpointFile::HEADER_SIZE != size) return false;
+    payload_ = data + CheckpointFile::HEADER_SIZE;
+    payload_size_ = size;
+    if (index_size != type_num_ * (sizeof(ID_TYPE) + SECTION_SIZE) || index_size > payload_size_) return false;
+    if (WriteAheadLog::Crc32(payload_, index_size) != crc) return false;
+
+    // Bound checks here let the section checks trust the table positions
+    for (size_t type = 0; type < type_num_; ++type) {
+        auto section = GetSection(type);
+        if (section.count > payload_size_ / (ENTRY_SIZE + PARENT_ENTRY_SIZE)) return false;
+        if (section.entries > payload_size_ - section.count * (ENTRY_SIZE + PARENT_ENTRY_SIZE)) return false;
+        if (section.parents != section.entries + section.count * ENTRY_SIZE) return false;
+    }
+    return true;
+}
+
+CheckpointImage::Section
+CheckpointImage::GetSection(size_t type) const {
+    auto section = payload_ + type_num_ * sizeof(ID_TYPE) + type * SECTION_SIZE;
+    return {Load<uint64_t>(section), Load<uint64_t>(section + sizeof(uint64_t)),
+            Load<uint64_t>(section + 2 * sizeof(uint64_t)), Load<uint64_t>(section + 3 * sizeof(uint64_t))};
+}
+
+bool
+CheckpointImage::VerifySection(size_t type) const {
+    auto& check = checks_[type];
+    std::call_once(check.once, [this, type, &check]() {
+        auto section = GetSection(type);
+        auto tables = payload_ + section.entries;
+        auto tables_size = section.count * (ENTRY_SIZE + PARENT_ENTRY_SIZE);
+        if (WriteAheadLog::Crc32(tables, tables_size) != section.crc) {
+            std::cerr << "Checkpoint tables of type " << type << " are corrupted" << std::endl;
+            return;
+        }
+        for (uint64_t i = 0; i < section.count; ++i) {
+            auto entry = tables + i * ENTRY_SIZE;
+            auto offset = Load<uint64_t>(entry + 2 * sizeof(uint64_t));
+            auto record_size = Load<uint64_t>(entry + 3 * sizeof(uint64_t));
+            if (offset > payload_size_ || record_size > payload_size_ - offset) {
+                std::cerr << "Checkpoint tables of type " << type << " are out of bounds" << std::endl;
+                return;
+            }
+        }
+        check.ok = true;
+    });
+    return check.ok;
+}
+
+bool
+CheckpointImage::VerifyRecord(const char* entry) const {
+    auto data = payload_ + Load<uint64_t>(entry + 2 * sizeof(uint64_t));
+    auto size = Load<uint64_t>(entry + 3 * sizeof(uint64_t));
+    if (WriteAheadLog::Crc32(data, size) == Load<uint64_t>(entry + 4 * sizeof(uint64_t))) return true;
+    std::cerr << "Checkpoint record " << Load<ID_TYPE>(entry) << " is corrupted" << std::endl;
+    return false;
+}
+
+ID_TYPE
+CheckpointImage::GetMaxId(size_t type) const {
+    return Load<ID_TYPE>(payload_ + type * sizeof(ID_TYPE));
+}
+
+size_t
+CheckpointImage::Size(size_t type) const {
+    return GetSection(type).count;
+}
+
+bool
+CheckpointImage::Find(size_t type, ID_TYPE id, const char*& data, size_t& size) const {
+    if (!VerifySection(type)) return false;
+    auto section = GetSection(type);
+    auto entries = payload_ + section.entries;
+    size_t lo = 0, hi = section.count;
+    while (lo < hi) {
+        auto mid = lo + (hi - lo) / 2;
+        auto entry = entries + mid * ENTRY_SIZE;
+        auto mid_id = Load<ID_TYPE>(entry);
+        if (mid_id < id) {
+            lo = mid + 1;
+        } else if (id < mid_id) {
+            hi = mid;
+        } else {
+            if (!VerifyRecord(entry)) return false;
+            data = payload_ + Load<uint64_t>(entry + 2 * sizeof(uint64_t));
+            size = Load<uint64_t>(entry + 3 * sizeof(uint64_t));
+            return true;
+        }
+    }
+    return false;
+}
+
+IDS_TYPE
+CheckpointImage::GetIdsByParent(size_t type, ID_TYPE parent_id) const {
+    IDS_TYPE ids;
+    if (!VerifySection(type)) return ids;
+    auto section = GetSection(type);
+    auto parents = payload_ + section.parents;
+    // Lower bound of parent_id
+    size_t lo = 0, hi = section.count;
+    while (lo < hi) {
+        auto mid = lo + (hi - lo) / 2;
+        if (Load<ID_TYPE>(parents + mid * PARENT_ENTRY_SIZE) < parent_id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    for (; lo < section.count; ++lo) {
+        auto entry = parents + lo * PARENT_ENTRY_SIZE;
+        if (Load<ID_TYPE>(entry) != parent_id) break;
+        ids.push_back(Load<ID_TYPE>(entry + sizeof(ID_TYPE)));
+    }
+    return ids;
+}
+
+bool
+CheckpointImage::ForEach(size_t type, const VisitorT& visitor) const {
+    if (!VerifySection(type)) return false;
+    auto section = GetSection(type);
+    auto entries = payload_ + section.entries;
+    for (uint64_t i = 0; i < section.count; ++i) {
+        auto entry = entries + i * ENTRY_SIZE;
+        if (!VerifyRecord(entry)) return false;
+        visitor(Load<ID_TYPE>(entry), Load<ID_TYPE>(entry + sizeof(uint64_t)),
+                payload_ + Load<uint64_t>(entry + 2 * sizeof(uint64_t)),
+                Load<uint64_t>(entry + 3 * sizeof(uint64_t)));
+    }
+    return true;
+}
+
+} // snapshot
+} // engine
+} // milvus
@@ -0,0 +1,125 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+#include "ResourceTypes.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+// A checkpoint file holds one opaque payload behind a header
+// [magic:u32][version:u32][size:u64][index size:u64][crc32:u32]. The crc only covers the index,
+// i.e. the first `index size` bytes of the payload, so that opening a checkpoint does not read
+// all of it. The rest of the payload carries its own checksums.
+// Files are replaced atomically: the new content goes to a temporary file that is fsync'ed and
+// then renamed over the old one, so a reader sees either the old or the new checkpoint.
+class CheckpointFile {
+public:
+    static constexpr uint32_t MAGIC = 0x504b434d; // "MCKP"
+    static constexpr uint32_t VERSION = 5;
+    static constexpr size_t HEADER_SIZE = 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t) + sizeof(uint32_t);
+
+    static bool Write(const std::string& path, const std::string& payload, size_t index_size);
+    // Make a rename of or into `path` durable
+    static bool SyncParentDir(const std::string& path);
+};
+
+// Checkpoint payload layout, all offsets relative to the payload:
+//   index:    [max id:i64] x types
+//             [count:u64][entries offset:u64][parents offset:u64][tables crc32:u64] x types
+//   encoded resources
+//   per type: entries [id:i64][parent id:i64][offset:u64][size:u64][record crc32:u64] sorted by id
+//             parents [parent id:i64][id:i64] sorted by parent id, then id
+// The tables crc covers the entries and parents of a type, which are stored back to back.
+// Resources without a parent index have parent id 0.
+class CheckpointImageBuilder {
+public:
+    explicit CheckpointImageBuilder(size_t type_num);
+
+    void SetMaxId(size_t type, ID_TYPE id);
+    void Add(size_t type, ID_TYPE id, ID_TYPE parent_id, const char* data, size_t size);
+    std::string Finish();
+    size_t IndexSize() const;
+
+private:
+    struct Entry {
+        ID_TYPE id;
+        ID_TYPE parent_id;
+        uint64_t offset;
+        uint64_t size;
+        uint32_t crc;
+    };
+
+    std::vector<ID_TYPE> max_ids_;
+    std::vector<std::vector<Entry>> entries_;
+    std::string records_;
+};
+
+// Read-only view of a checkpoint mapped into memory. Nothing is decoded up front: lookups
+// binary search the flat tables and hand out the encoded bytes of a resource.
+// Only the header and index are verified on open. The tables of a type are verified when the type
+// is first looked at and a record whenever it is handed out; a lookup that hits corruption
+// reports it and finds nothing
+class CheckpointImage {
+public:
+    using Ptr = std::shared_ptr<CheckpointImage>;
+    using VisitorT = std::function<void(ID_TYPE id, ID_TYPE parent_id, const char* data, size_t size)>;
+
+    ~CheckpointImage();
+
+    // nullptr if there is no checkpoint at `path` or it is corrupted. The latter sets `corrupted`
+    static Ptr Open(const std::string& path, size_t type_num, bool& corrupted);
+
+    ID_TYPE GetMaxId(size_t type) const;
+    size_t Size(size_t type) const;
+    bool Find(size_t type, ID_TYPE id, const char*& data, size_t& size) const;
+    IDS_TYPE GetIdsByParent(size_t type, ID_TYPE parent_id) const;
+    // False if the tables or a record of `type` are corrupted
+    bool ForEach(size_t type, const VisitorT& visitor) const;
+
+private:
+    CheckpointImage() = default;
+    bool Validate();
+
+    struct Section {
+        uint64_t count;
+        uint64_t entries;
+        uint64_t parents;
+        uint64_t crc;
+    };
+
+    struct SectionCheck {
+        std::once_flag once;
+        bool ok = false;
+    };
+
+    Section GetSection(size_t type) const;
+    bool VerifySection(size_t type) const;
+    bool VerifyRecord(const char* entry) const;
+
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    const char* payload_ = nullptr;
+    size_t payload_size_ = 0;
+    size_t type_num_ = 0;
+    mutable std::unique_ptr<SectionCheck[]> checks_;
+};
+
+} // snapshot
+} // engine
+} // milvus
@@ -17,6 +17,47 @@ namespace milvus {
 namespace engine {
 namespace snapshot {
 
+// One context per field element of the current schema of `ss`
+static std::vector<SegmentFileContext>
+SchemaSegmentFileContexts(const ScopedSnapshotT& ss) {
+    std::vector<SegmentFileContext> contexts;
+    for (auto& field_name : ss->GetFieldNames()) {
+        for (auto& field_element_name : ss->GetFieldElementNames(field_name)) {
+            SegmentFileContext context;
+            context.field_name = field_name;
+            context.field_element_name = field_element_name;
+            contexts.push_back(context);
+        }
+    }
+    return contexts;
+}
+
+static std::vector<SegmentFileContext>
+BindToSegment(const std::vector<SegmentFileContext>& contexts, const SegmentPtr& segment) {
+    auto bound = contexts;
+    for (auto& context : bound) {
+        context.segment_id = segment->GetID();
+        context.partition_id = segment->GetPartitionId();
+    }
+    return bound;
+}
+
+static void
+AppendSegmentFiles(SegmentFile::VecT& files, const SegmentFile::VecT& new_files) {
+    files.insert(files.end(), new_files.begin(), new_files.end());
+}
+
+// Commit the files of `contexts` in one operation and record them as new files of `context`
+static SegmentFile::VecT
+CommitSegmentFiles(OperationContext& context, const std::vector<SegmentFileContext>& contexts,
+                   const ScopedSnapshotT& ss) {
+    auto op = std::make_shared<SegmentFilesOperation>(contexts, ss);
+    OperationExecutor::GetInstance().Submit(op);
+    auto new_files = op->GetResources();
+    AppendSegmentFiles(context.new_segment_files, new_files);
+    return new_files;
+}
+
 BuildOperation::BuildOperation(const OperationContext& context, ScopedSnapshotT prev_ss)
     : BaseT(context, prev_ss) {};
 BuildOperation::BuildOperation(const OperationContext& context, ID_TYPE collection_id, ID_TYPE commit_id)
@@ -37,12 +78,15 @@ BuildOperation::PreExecute(Store& store) {
     CollectionCommitOperation cc_op(cc_context, prev_ss_);
     cc_op(store);
 
+    // Segment files were stored by earlier operations: activate copies, so that a failed commit
+    // can restore the stored ones. What the operations above created goes in as is
     for (auto& new_segment_file : context_.new_segment_files) {
-        AddStep(*new_segment_file);
+        if (!new_segment_file) return false;
+        AddStep(std::make_shared<SegmentFile>(*new_segment_file));
     }
-    AddStep(*context_.new_segment_commit);
-    AddStep(*pc_op.GetResource());
-    AddStep(*cc_op.GetResource());
+    AddStep(context_.new_segment_commit);
+    AddStep(pc_op.GetResource());
+    AddStep(cc_op.GetResource());
     return true;
 }
 
@@ -71,10 +115,10 @@ BuildOperation::DoExecute(Store& store) {
         // PXU TODO: Produce cleanup job
         return false;
     }
-    std::any_cast<SegmentFilePtr>(steps_[0])->Activate();
-    std::any_cast<SegmentCommitPtr>(steps_[1])->Activate();
-    std::any_cast<PartitionCommitPtr>(steps_[2])->Activate();
-    std::any_cast<CollectionCommitPtr>(steps_[3])->Activate();
+    std::get<SegmentFilePtr>(steps_[0])->Activate();
+    std::get<SegmentCommitPtr>(steps_[1])->Activate();
+    std::get<PartitionCommitPtr>(steps_[2])->Activate();
+    std::get<CollectionCommitPtr>(steps_[3])->Activate();
     return true;
 }
 
@@ -82,11 +126,25 @@ SegmentFilePtr
 BuildOperation::CommitNewSegmentFile(const SegmentFileContext& context) {
     auto new_sf_op = std::make_shared<SegmentFileOperation>(context, prev_ss_);
     OperationExecutor::GetInstance().Submit(new_sf_op);
-    new_sf_op->WaitToFinish();
     context_.new_segment_files.push_back(new_sf_op->GetResource());
     return new_sf_op->GetResource();
 }
 
+void
+BuildOperation::CommitNewSegmentFileAsync(const SegmentFileContext& context, OperationCallbackT cb) {
+    auto self = std::static_pointer_cast<BuildOperation>(shared_from_this());
+    auto new_sf_op = std::make_shared<SegmentFileOperation>(context, prev_ss_);
+    new_sf_op->PushAsync([self, new_sf_op, cb](OpStatus status) {
+        if (status == OP_OK) self->context_.new_segment_files.push_back(new_sf_op->GetResource());
+        if (cb) cb(status);
+    });
+}
+
+SegmentFile::VecT
+BuildOperation::CommitNewSegmentFiles(const std::vector<SegmentFileContext>& contexts) {
+    return CommitSegmentFiles(context_, contexts, prev_ss_);
+}
+
 NewSegmentOperation::NewSegmentOperation(const OperationContext& context, ScopedSnapshotT prev_ss)
     : BaseT(context, prev_ss) {};
 NewSegmentOperation::NewSegmentOperation(const OperationContext& context, ID_TYPE collection_id, ID_TYPE commit_id)
@@ -96,12 +154,12 @@ bool
 NewSegmentOperation::DoExecute(Store& store) {
     auto i = 0;
     for(; i<context_.new_segment_files.size(); ++i) {
-        std::any_cast<SegmentFilePtr>(steps_[i])->Activate();
+        std::get<SegmentFilePtr>(steps_[i])->Activate();
     }
-    std::any_cast<SegmentPtr>(steps_[i++])->Activate();
-    std::any_cast<SegmentCommitPtr>(steps_[i++])->Activate();
-    std::any_cast<PartitionCommitPtr>(steps_[i++])->Activate();
-    std::any_cast<CollectionCommitPtr>(steps_[i++])->Activate();
+    std::get<SegmentPtr>(steps_[i++])->Activate();
+    std::get<SegmentCommitPtr>(steps_[i++])->Activate();
+    std::get<PartitionCommitPtr>(steps_[i++])->Activate();
+    std::get<CollectionCommitPtr>(steps_[i++])->Activate();
     return true;
 }
 
@@ -110,6 +168,8 @@ NewSegmentOperation::PreExecute(Store& store) {
     // PXU TODO:
     // 1. Check all requried field elements have related segment files
     // 2. Check Stale and others
+    // The segment's own commit failed
+    if (!context_.new_segment) return false;
     SegmentCommitOperation op(context_, prev_ss_);
     op(store);
     context_.new_segment_commit = op.GetResource();
@@ -124,12 +184,13 @@ NewSegmentOperation::PreExecute(Store& store) {
     cc_op(store);
 
     for (auto& new_segment_file : context_.new_segment_files) {
-        AddStep(*new_segment_file);
+        if (!new_segment_file) return false;
+        AddStep(std::make_shared<SegmentFile>(*new_segment_file));
     }
-    AddStep(*context_.new_segment);
-    AddStep(*context_.new_segment_commit);
-    AddStep(*pc_op.GetResource());
-    AddStep(*cc_op.GetResource());
+    AddStep(std::make_shared<Segment>(*context_.new_segment));
+    AddStep(context_.new_segment_commit);
+    AddStep(pc_op.GetResource());
+    AddStep(cc_op.GetResource());
     return true;
 }
 
@@ -137,23 +198,75 @@ SegmentPtr
 NewSegmentOperation::CommitNewSegment() {
     auto op = std::make_shared<SegmentOperation>(context_, prev_ss_);
     OperationExecutor::GetInstance().Submit(op);
-    op->WaitToFinish();
     context_.new_segment = op->GetResource();
     return context_.new_segment;
 }
 
 SegmentFilePtr
 NewSegmentOperation::CommitNewSegmentFile(const SegmentFileContext& context) {
+    if (!context_.new_segment) return nullptr;
     auto c = context;
     c.segment_id = context_.new_segment->GetID();
     c.partition_id = context_.new_segment->GetPartitionId();
     auto new_sf_op = std::make_shared<SegmentFileOperation>(c, prev_ss_);
     OperationExecutor::GetInstance().Submit(new_sf_op);
-    new_sf_op->WaitToFinish();
     context_.new_segment_files.push_back(new_sf_op->GetResource());
     return new_sf_op->GetResource();
 }
 
+SegmentFile::VecT
+NewSegmentOperation::CommitNewSegmentFiles() {
+    return CommitNewSegmentFiles(SchemaSegmentFileContexts(prev_ss_));
+}
+
+SegmentFile::VecT
+NewSegmentOperation::CommitNewSegmentFiles(const std::vector<SegmentFileContext>& contexts) {
+    if (!context_.new_segment) return SegmentFile::VecT();
+    return CommitSegmentFiles(context_, BindToSegment(contexts, context_.new_segment), prev_ss_);
+}
+
+void
+NewSegmentOperation::CommitNewSegmentAsync(OperationCallbackT cb) {
+    auto self = std::static_pointer_cast<NewSegmentOperation>(shared_from_this());
+    auto op = std::make_shared<SegmentOperation>(context_, prev_ss_);
+    op->PushAsync([self, op, cb](OpStatus status) {
+        self->context_.new_segment = op->GetResource();
+        if (cb) cb(status);
+    });
+}
+
+void
+NewSegmentOperation::CommitNewSegmentFileAsync(const SegmentFileContext& context, OperationCallbackT cb) {
+    if (!context_.new_segment) {
+        if (cb) cb(OP_FAIL_INVALID_PARAMS);
+        return;
+    }
+    auto self = std::static_pointer_cast<NewSegmentOperation>(shared_from_this());
+    auto c = context;
+    c.segment_id = context_.new_segment->GetID();
+    c.partition_id = context_.new_segment->GetPartitionId();
+    auto new_sf_op = std::make_shared<SegmentFileOperation>(c, prev_ss_);
+    new_sf_op->PushAsync([self, new_sf_op, cb](OpStatus status) {
+        if (status == OP_OK) self->context_.new_segment_files.push_back(new_sf_op->GetResource());
+        if (cb) cb(status);
+    });
+}
+
+void
+NewSegmentOperation::CommitNewSegmentFilesAsync(OperationCallbackT cb) {
+    if (!context_.new_segment) {
+        if (cb) cb(OP_FAIL_INVALID_PARAMS);
+        return;
+    }
+    auto self = std::static_pointer_cast<NewSegmentOperation>(shared_from_this());
+    auto contexts = BindToSegment(SchemaSegmentFileContexts(prev_ss_), context_.new_segment);
+    auto op = std::make_shared<SegmentFilesOperation>(contexts, prev_ss_);
+    op->PushAsync([self, op, cb](OpStatus status) {
+        if (status == OP_OK) AppendSegmentFiles(self->context_.new_segment_files, op->GetResources());
+        if (cb) cb(status);
+    });
+}
+
 MergeOperation::MergeOperation(const OperationContext& context, ScopedSnapshotT prev_ss)
     : BaseT(context, prev_ss) {};
 MergeOperation::MergeOperation(const OperationContext& context, ID_TYPE collection_id, ID_TYPE commit_id)
@@ -164,7 +277,6 @@ MergeOperation::CommitNewSegment() {
     if (context_.new_segment) return context_.new_segment;
     auto op = std::make_shared<SegmentOperation>(context_, prev_ss_);
     OperationExecutor::GetInstance().Submit(op);
-    op->WaitToFinish();
     context_.new_segment = op->GetResource();
     return context_.new_segment;
 }
@@ -173,21 +285,86 @@ SegmentFilePtr
 MergeOperation::CommitNewSegmentFile(const SegmentFileContext& context) {
     // PXU TODO: Check element type and segment file mapping rules
     auto new_segment = CommitNewSegment();
+    if (!new_segment) return nullptr;
     auto c = context;
     c.segment_id = new_segment->GetID();
     c.partition_id = new_segment->GetPartitionId();
     auto new_sf_op = std::make_shared<SegmentFileOperation>(c, prev_ss_);
     OperationExecutor::GetInstance().Submit(new_sf_op);
-    new_sf_op->WaitToFinish();
     context_.new_segment_files.push_back(new_sf_op->GetResource());
     return new_sf_op->GetResource();
 }
 
+SegmentFile::VecT
+MergeOperation::CommitNewSegmentFiles() {
+    return CommitNewSegmentFiles(SchemaSegmentFileContexts(prev_ss_));
+}
+
+SegmentFile::VecT
+MergeOperation::CommitNewSegmentFiles(const std::vector<SegmentFileContext>& contexts) {
+    auto new_segment = CommitNewSegment();
+    if (!new_segment) return SegmentFile::VecT();
+    return CommitSegmentFiles(context_, BindToSegment(contexts, new_segment), prev_ss_);
+}
+
+void
+MergeOperation::CommitNewSegmentAsync(OperationCallbackT cb) {
+    if (context_.new_segment) {
+        if (cb) cb(OP_OK);
+        return;
+    }
+    auto self = std::static_pointer_cast<MergeOperation>(shared_from_this());
+    auto op = std::make_shared<SegmentOperation>(context_, prev_ss_);
+    op->PushAsync([self, op, cb](OpStatus status) {
+        self->context_.new_segment = op->GetResource();
+        if (cb) cb(status);
+    });
+}
+
+void
+MergeOperation::CommitNewSegmentFileAsync(const SegmentFileContext& context, OperationCallbackT cb) {
+    // Same as the blocking version: the merged segment is created by the first segment file
+    auto self = std::static_pointer_cast<MergeOperation>(shared_from_this());
+    CommitNewSegmentAsync([self, context, cb](OpStatus status) {
+        if (status != OP_OK || !self->context_.new_segment) {
+            if (cb) cb(status == OP_OK ? OP_FAIL_INVALID_PARAMS : status);
+            return;
+        }
+        auto c = context;
+        c.segment_id = self->context_.new_segment->GetID();
+        c.partition_id = self->context_.new_segment->GetPartitionId();
+        auto new_sf_op = std::make_shared<SegmentFileOperation>(c, self->prev_ss_);
+        new_sf_op->PushAsync([self, new_sf_op, cb](OpStatus status) {
+            if (status == OP_OK) self->context_.new_segment_files.push_back(new_sf_op->GetResource());
+            if (cb) cb(status);
+        });
+    });
+}
+
+void
+MergeOperation::CommitNewSegmentFilesAsync(OperationCallbackT cb) {
+    auto self = std::static_pointer_cast<MergeOperation>(shared_from_this());
+    CommitNewSegmentAsync([self, cb](OpStatus status) {
+        if (status != OP_OK || !self->context_.new_segment) {
+            if (cb) cb(status == OP_OK ? OP_FAIL_INVALID_PARAMS : status);
+            return;
+        }
+        auto contexts = BindToSegment(SchemaSegmentFileContexts(self->prev_ss_), self->context_.new_segment);
+        auto op = std::make_shared<SegmentFilesOperation>(contexts, self->prev_ss_);
+        op->PushAsync([self, op, cb](OpStatus status) {
+            if (status == OP_OK) AppendSegmentFiles(self->context_.new_segment_files, op->GetResources());
+            if (cb) cb(status);
+        });
+    });
+}
+
 bool
 MergeOperation::PreExecute(Store& store) {
     // PXU TODO:
     // 1. Check all requried field elements have related segment files
     // 2. Check Stale and others
+    // The segment's own commit failed
+    if (!context_.new_segment) return false;
     SegmentCommitOperation op(context_, prev_ss_);
     op(store);
     context_.new_segment_commit = op.GetResource();
@@ -204,12 +381,13 @@ MergeOperation::PreExecute(Store& store) {
     cc_op(store);
 
     for (auto& new_segment_file : context_.new_segment_files) {
-        AddStep(*new_segment_file);
+        if (!new_segment_file) return false;
+        AddStep(std::make_shared<SegmentFile>(*new_segment_file));
     }
-    AddStep(*context_.new_segment);
-    AddStep(*context_.new_segment_commit);
-    AddStep(*pc_op.GetResource());
-    AddStep(*cc_op.GetResource());
+    AddStep(std::make_shared<Segment>(*context_.new_segment));
+    AddStep(context_.new_segment_commit);
+    AddStep(pc_op.GetResource());
+    AddStep(cc_op.GetResource());
     return true;
 }
 
@@ -217,12 +395,12 @@ bool
 MergeOperation::DoExecute(Store& store) {
     auto i = 0;
     for(; i<context_.new_segment_files.size(); ++i) {
-        std::any_cast<SegmentFilePtr>(steps_[i])->Activate();
+        std::get<SegmentFilePtr>(steps_[i])->Activate();
     }
-    std::any_cast<SegmentPtr>(steps_[i++])->Activate();
-    std::any_cast<SegmentCommitPtr>(steps_[i++])->Activate();
-    std::any_cast<PartitionCommitPtr>(steps_[i++])->Activate();
-    std::any_cast<CollectionCommitPtr>(steps_[i++])->Activate();
+    std::get<SegmentPtr>(steps_[i++])->Activate();
+    std::get<SegmentCommitPtr>(steps_[i++])->Activate();
+    std::get<PartitionCommitPtr>(steps_[i++])->Activate();
+    std::get<CollectionCommitPtr>(steps_[i++])->Activate();
     return true;
 }
 
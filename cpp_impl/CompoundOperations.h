@@ -29,6 +29,10 @@ public:
     bool PreExecute(Store&) override;
 
     SegmentFilePtr CommitNewSegmentFile(const SegmentFileContext& context);
+    void CommitNewSegmentFileAsync(const SegmentFileContext& context, OperationCallbackT cb);
+
+    // Commit several segment files in one executor hop and one store transaction
+    SegmentFile::VecT CommitNewSegmentFiles(const std::vector<SegmentFileContext>& contexts);
 };
 
 class NewSegmentOperation : public Operations {
@@ -45,6 +49,18 @@ public:
     SegmentPtr CommitNewSegment();
 
     SegmentFilePtr CommitNewSegmentFile(const SegmentFileContext& context);
+
+    // Commit the new segment's files in one executor hop and one store transaction. Without
+    // contexts one file is created for every field element of the current schema
+    SegmentFile::VecT CommitNewSegmentFiles();
+    SegmentFile::VecT CommitNewSegmentFiles(const std::vector<SegmentFileContext>& contexts);
+
+    // Non-blocking variants: `cb` runs on the executor lane once the resource is committed and
+    // recorded in this operation, so the next hop can be submitted from it, e.g.
+    // CommitNewSegmentAsync -> CommitNewSegmentFileAsync -> PushAsync
+    void CommitNewSegmentAsync(OperationCallbackT cb);
+    void CommitNewSegmentFileAsync(const SegmentFileContext& context, OperationCallbackT cb);
+    void CommitNewSegmentFilesAsync(OperationCallbackT cb);
 };
 
 class MergeOperation : public Operations {
@@ -59,6 +75,12 @@ public:
 
     SegmentPtr CommitNewSegment();
     SegmentFilePtr CommitNewSegmentFile(const SegmentFileContext& context);
+    SegmentFile::VecT CommitNewSegmentFiles();
+    SegmentFile::VecT CommitNewSegmentFiles(const std::vector<SegmentFileContext>& contexts);
+
+    void CommitNewSegmentAsync(OperationCallbackT cb);
+    void CommitNewSegmentFileAsync(const SegmentFileContext& context, OperationCallbackT cb);
+    void CommitNewSegmentFilesAsync(OperationCallbackT cb);
 };
 
 class GetSnapshotIDsOperation : public Operations {
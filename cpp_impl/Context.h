@@ -20,6 +20,8 @@ struct LoadOperationContext {
     ID_TYPE id = 0;
     State status = INVALID;
     std::string name;
+    // Loaded together by a LoadResourcesOperation
+    IDS_TYPE ids;
 };
 
 struct OperationContext {
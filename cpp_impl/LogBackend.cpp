@@ -0,0 +1,256 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include "LogBackend.h"
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+LogBackend::~LogBackend() {
+    Close();
+}
+
+bool
+LogBackend::Open(const std::string& dir, size_t type_num) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    WaitForCheckpointNoLock(lock);
+    checkpoint_path_ = dir + "/meta.ckpt";
+    bool corrupted;
+    image_ = CheckpointImage::Open(checkpoint_path_, type_num, corrupted);
+    if (corrupted) return false;
+    overlays_.clear();
+    overlays_.resize(type_num);
+    return wal_.Open(dir + "/meta.wal", [this](const std::string& record) {
+        return ApplyNoLock(record);
+    });
+}
+
+void
+LogBackend::Close() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    WaitForCheckpointNoLock(lock);
+    wal_.Close();
+    image_.reset();
+    overlays_.clear();
+}
+
+const LogBackend::OverlayEntry*
+LogBackend::FindEntryNoLock(size_t type, ID_TYPE id) const {
+    for (auto layer : {&overlays_, &frozen_}) {
+        if (type >= layer->size()) continue;
+        auto& entries = (*layer)[type].entries;
+        auto it = entries.find(id);
+        if (it != entries.end()) return &it->second;
+    }
+    return nullptr;
+}
+
+IDS_TYPE
+LogBackend::MergeIds(const IDS_TYPE& image_ids, IDS_TYPE&& overlay_ids) {
+    std::sort(overlay_ids.begin(), overlay_ids.end());
+    IDS_TYPE ids;
+    std::merge(image_ids.begin(), image_ids.end(), overlay_ids.begin(), overlay_ids.end(), std::back_inserter(ids));
+    return ids;
+}
+
+ID_TYPE
+LogBackend::GetMaxId(size_t type) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto id = overlays_[type].max_id;
+    if (type < frozen_.size()) id = std::max(id, frozen_[type].max_id);
+    if (image_) id = std::max(id, image_->GetMaxId(type));
+    return id;
+}
+
+bool
+LogBackend::Get(size_t type, ID_TYPE id, std::string& record) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto entry = FindEntryNoLock(type, id);
+    if (entry) {
+        if (entry->removed) return false;
+        record = entry->record;
+        return true;
+    }
+    const char* data;
+    size_t size;
+    if (!image_ || !image_->Find(type, id, data, size)) return false;
+    record.assign(data, size);
+    return true;
+}
+
+IDS_TYPE
+LogBackend::GetIds(size_t type) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    IDS_TYPE image_ids, overlay_ids;
+    if (image_) {
+        image_->ForEach(type, [&](ID_TYPE id, ID_TYPE, const char*, size_t) {
+            if (!FindEntryNoLock(type, id)) image_ids.push_back(id);
+        });
+    }
+    for (auto layer : {&overlays_, &frozen_}) {
+        if (type >= layer->size()) continue;
+        for (auto& kv : (*layer)[type].entries) {
+            if (!kv.second.removed && FindEntryNoLock(type, kv.first) == &kv.second) overlay_ids.push_back(kv.first);
+        }
+    }
+    return MergeIds(image_ids, std::move(overlay_ids));
+}
+
+IDS_TYPE
+LogBackend::GetIdsByParent(size_t type, ID_TYPE parent_id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    IDS_TYPE image_ids, overlay_ids;
+    if (image_) {
+        for (auto id : image_->GetIdsByParent(type, parent_id)) {
+            if (!FindEntryNoLock(type, id)) image_ids.push_back(id);
+        }
+    }
+    for (auto layer : {&overlays_, &frozen_}) {
+        if (type >= layer->size()) continue;
+        auto& overlay = (*layer)[type];
+        auto it = overlay.children.find(parent_id);
+        if (it == overlay.children.end()) continue;
+        for (auto id : it->second) {
+            // Skip what the live overlay has changed since the frozen one was taken
+            if (FindEntryNoLock(type, id) == &overlay.entries.at(id)) overlay_ids.push_back(id);
+        }
+    }
+    return MergeIds(image_ids, std::move(overlay_ids));
+}
+
+bool
+LogBackend::Commit(const std::string& batch) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!wal_.Append(batch)) return false;
+    if (!ApplyNoLock(batch)) return false;
+    if (wal_.Size() >= checkpoint_wal_size_ && !checkpointing_) {
+        if (checkpoint_thread_.joinable()) checkpoint_thread_.join();
+        FreezeNoLock();
+        checkpoint_thread_ = std::thread([this]() { BuildCheckpoint(); });
+    }
+    return true;
+}
+
+void
+LogBackend::PutEntry(Overlay& overlay, ID_TYPE id, OverlayEntry&& entry) {
+    auto inserted = overlay.entries.try_emplace(id, OverlayEntry{true, 0, std::string()});
+    auto& current = inserted.first->second;
+    if (!current.removed) {
+        auto it = overlay.children.find(current.parent_id);
+        if (it != overlay.children.end()) {
+            it->second.erase(id);
+            if (it->second.empty()) overlay.children.erase(it);
+        }
+    }
+    current = std::move(entry);
+    if (current.removed) return;
+    overlay.children[current.parent_id].insert(id);
+    overlay.max_id = std::max(overlay.max_id, id);
+}
+
+bool
+LogBackend::ApplyNoLock(const std::string& batch) {
+    return MetaBatch::ForEach(batch, [this](const MetaMutation& mutation) {
+        if (mutation.type >= overlays_.size()) return false;
+        if (mutation.kind == MetaMutation::REMOVE) {
+            PutEntry(overlays_[mutation.type], mutation.id, OverlayEntry{true, 0, std::string()});
+        } else {
+            PutEntry(overlays_[mutation.type], mutation.id,
+                    OverlayEntry{false, mutation.parent_id, std::string(mutation.data, mutation.size)});
+        }
+        return true;
+    });
+}
+
+bool
+LogBackend::Checkpoint() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    WaitForCheckpointNoLock(lock);
+    if (!wal_.IsOpen()) return false;
+    FreezeNoLock();
+    lock.unlock();
+    return BuildCheckpoint();
+}
+
+void
+LogBackend::WaitForCheckpointNoLock(std::unique_lock<std::mutex>& lock) {
+    checkpoint_cond_.wait(lock, [this]() { return !checkpointing_; });
+    if (checkpoint_thread_.joinable()) checkpoint_thread_.join();
+}
+
+void
+LogBackend::FreezeNoLock() {
+    frozen_.swap(overlays_);
+    overlays_.clear();
+    overlays_.resize(frozen_.size());
+    frozen_wal_size_ = wal_.Size();
+    checkpointing_ = true;
+}
+
+bool
+LogBackend::BuildCheckpoint() {
+    // Nothing else changes frozen_ or replaces image_ while a checkpoint runs, so both are read
+    // without the lock here
+    auto type_num = frozen_.size();
+    CheckpointImageBuilder builder(type_num);
+    auto ok = true;
+    for (size_t type = 0; ok && type < type_num; ++type) {
+        auto& overlay = frozen_[type];
+        builder.SetMaxId(type, std::max(overlay.max_id, image_ ? image_->GetMaxId(type) : 0));
+        // Resources untouched since the last checkpoint are copied over without decoding. A
+        // corrupted image is not carried over into a new one
+        if (image_) {
+            ok = image_->ForEach(type, [&](ID_TYPE id, ID_TYPE parent_id, const char* data, size_t size) {
+                if (overlay.entries.find(id) == overlay.entries.end()) builder.Add(type, id, parent_id, data, size);
+            });
+        }
+        for (auto& kv : overlay.entries) {
+            if (kv.second.removed) continue;
+            builder.Add(type, kv.first, kv.second.parent_id, kv.second.record.data(), kv.second.record.size());
+        }
+    }
+    CheckpointImage::Ptr image;
+    if (ok && CheckpointFile::Write(checkpoint_path_, builder.Finish(), builder.IndexSize())) {
+        bool corrupted;
+        image = CheckpointImage::Open(checkpoint_path_, type_num, corrupted);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (image) {
+        image_ = image;
+        frozen_.clear();
+        // Replaying records the checkpoint already holds is harmless, so a crash before the log is
+        // cut loses nothing
+        ok = wal_.DropPrefix(frozen_wal_size_);
+    } else {
+        // Fold what was committed meanwhile into the frozen overlay and keep that as the live one
+        for (size_t type = 0; type < type_num; ++type) {
+            for (auto& kv : overlays_[type].entries) {
+                PutEntry(frozen_[type], kv.first, std::move(kv.second));
+            }
+            frozen_[type].max_id = std::max(frozen_[type].max_id, overlays_[type].max_id);
+        }
+        overlays_.swap(frozen_);
+        frozen_.clear();
+        ok = false;
+    }
+    checkpointing_ = false;
+    checkpoint_cond_.notify_all();
+    return ok;
+}
+
+} // snapshot
+} // engine
+} // milvus
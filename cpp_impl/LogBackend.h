@@ -0,0 +1,96 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+#include "MetaBackend.h"
+#include "Checkpoint.h"
+#include "WriteAheadLog.h"
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+// Backend made of a memory-mapped checkpoint image and a write-ahead log of the batches
+// committed since. The log tail is kept as an overlay of encoded records on top of the image.
+// Every batch is appended and fsync'ed as one log record. A checkpoint freezes the overlay,
+// merges it into a new image without holding the backend lock while commits go to a fresh
+// overlay, and then drops the log up to where it was frozen
+class LogBackend : public MetaBackend {
+public:
+    ~LogBackend() override;
+
+    bool Open(const std::string& dir, size_t type_num) override;
+    void Close() override;
+
+    ID_TYPE GetMaxId(size_t type) override;
+    bool Get(size_t type, ID_TYPE id, std::string& record) override;
+    IDS_TYPE GetIds(size_t type) override;
+    IDS_TYPE GetIdsByParent(size_t type, ID_TYPE parent_id) override;
+
+    bool Commit(const std::string& batch) override;
+    bool Checkpoint() override;
+
+    // A checkpoint is started in the background once the log has grown to `wal_size` bytes
+    void SetCheckpointInterval(uint64_t wal_size) { checkpoint_wal_size_ = wal_size; }
+
+private:
+    struct OverlayEntry {
+        bool removed;
+        ID_TYPE parent_id;
+        std::string record;
+    };
+
+    struct Overlay {
+        std::map<ID_TYPE, OverlayEntry> entries;
+        std::map<ID_TYPE, std::set<ID_TYPE>> children;
+        ID_TYPE max_id = 0;
+    };
+
+    static void PutEntry(Overlay& overlay, ID_TYPE id, OverlayEntry&& entry);
+
+    bool ApplyNoLock(const std::string& batch);
+    // The entry of `id` in the live or else the frozen overlay, nullptr if neither has one
+    const OverlayEntry* FindEntryNoLock(size_t type, ID_TYPE id) const;
+    // Overlay ids may come from both overlays and unsorted
+    static IDS_TYPE MergeIds(const IDS_TYPE& image_ids, IDS_TYPE&& overlay_ids);
+
+    // Checkpoint in three steps: freeze the overlay under the lock, build and write the image
+    // from it without the lock, then install the image under the lock again
+    void FreezeNoLock();
+    bool BuildCheckpoint();
+    void WaitForCheckpointNoLock(std::unique_lock<std::mutex>& lock);
+
+    std::mutex mutex_;
+    std::condition_variable checkpoint_cond_;
+    std::string checkpoint_path_;
+    CheckpointImage::Ptr image_;
+    std::vector<Overlay> overlays_;
+    // Overlay being merged into the next image, empty unless a checkpoint runs
+    std::vector<Overlay> frozen_;
+    // Log size when frozen_ was taken
+    uint64_t frozen_wal_size_ = 0;
+    bool checkpointing_ = false;
+    std::thread checkpoint_thread_;
+    WriteAheadLog wal_;
+    std::atomic<uint64_t> checkpoint_wal_size_ = 64UL << 20;
+};
+
+} // snapshot
+} // engine
+} // milvus
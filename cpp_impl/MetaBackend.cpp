@@ -0,0 +1,44 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include "MetaBackend.h"
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+bool
+MetaBatch::ForEach(const std::string& batch, const std::function<bool(const MetaMutation&)>& handler) {
+    BinaryReader reader(batch.data(), batch.size());
+    while (!reader.Done()) {
+        MetaMutation mutation;
+        mutation.kind = static_cast<MetaMutation::Kind>(reader.Read<uint8_t>());
+        mutation.type = reader.Read<uint8_t>();
+        mutation.id = reader.Read<ID_TYPE>();
+        mutation.parent_id = 0;
+        mutation.data = nullptr;
+        mutation.size = 0;
+        if (mutation.kind == MetaMutation::PUT) {
+            mutation.parent_id = reader.Read<ID_TYPE>();
+            auto size = reader.Read<uint32_t>();
+            mutation.data = reader.Skip(size);
+            mutation.size = size;
+        } else if (mutation.kind != MetaMutation::REMOVE) {
+            return false;
+        }
+        if (!reader.Ok() || !handler(mutation)) return false;
+    }
+    return true;
+}
+
+} // snapshot
+} // engine
+} // milvus
@@ -0,0 +1,102 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+#include "ResourceTypes.h"
+#include "ResourceCodec.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+// One change to a backend. `type` is the resource type index in Store::MockResourcesT and the
+// record of a put is the ResourceCodec encoding of the resource
+struct MetaMutation {
+    enum Kind : uint8_t {
+        PUT = 1,
+        REMOVE = 2,
+    };
+
+    Kind kind;
+    size_t type;
+    ID_TYPE id;
+    ID_TYPE parent_id;
+    const char* data;
+    size_t size;
+};
+
+// The changes of one store transaction, encoded as a sequence of
+// [kind:u8][type:u8][id:i64] followed for puts by [parent id:i64][size:u32][record]
+class MetaBatch {
+public:
+    explicit MetaBatch(std::string& buffer) : writer_(buffer) {}
+
+    template <typename ResourceT>
+    void Put(size_t type, ID_TYPE parent_id, const ResourceT& resource) {
+        writer_.Write<uint8_t>(MetaMutation::PUT);
+        writer_.Write<uint8_t>(type);
+        writer_.Write(resource.GetID());
+        writer_.Write(parent_id);
+        std::string record;
+        BinaryWriter writer(record);
+        ResourceCodec<ResourceT>::Encode(writer, resource);
+        writer_.WriteString(record);
+    }
+
+    void Remove(size_t type, ID_TYPE id) {
+        writer_.Write<uint8_t>(MetaMutation::REMOVE);
+        writer_.Write<uint8_t>(type);
+        writer_.Write(id);
+    }
+
+    // False if `batch` is malformed or `handler` fails
+    static bool ForEach(const std::string& batch, const std::function<bool(const MetaMutation&)>& handler);
+
+private:
+    BinaryWriter writer_;
+};
+
+// Durable storage behind Store. Store keeps every resource it has created or loaded in memory
+// and goes to the backend for the rest: reads of resources it has not seen yet, and the parent
+// indexes. Writes reach the backend as one batch per store transaction.
+// All methods are thread safe
+class MetaBackend {
+public:
+    using Ptr = std::shared_ptr<MetaBackend>;
+
+    virtual ~MetaBackend() = default;
+
+    // Open or create the backend in `dir` for `type_num` resource types
+    virtual bool Open(const std::string& dir, size_t type_num) = 0;
+    virtual void Close() = 0;
+
+    // Largest id ever stored for `type`, also if that resource was removed since
+    virtual ID_TYPE GetMaxId(size_t type) = 0;
+    virtual bool Get(size_t type, ID_TYPE id, std::string& record) = 0;
+    // Sorted ascending
+    virtual IDS_TYPE GetIds(size_t type) = 0;
+    // Sorted ascending
+    virtual IDS_TYPE GetIdsByParent(size_t type, ID_TYPE parent_id) = 0;
+
+    // Durably apply one MetaBatch
+    virtual bool Commit(const std::string& batch) = 0;
+
+    // Compact whatever the backend accumulates between checkpoints
+    virtual bool Checkpoint() = 0;
+};
+
+} // snapshot
+} // engine
+} // milvus
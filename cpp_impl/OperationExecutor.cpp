@@ -11,6 +11,8 @@
 
 #include "OperationExecutor.h"
 #include <iostream>
+#include <functional>
+#include <limits>
 
 namespace milvus {
 namespace engine {
@@ -36,42 +38,125 @@ OperationExecutor::Submit(OperationsPtr operation) {
     return operation->WaitToFinish();
 }
 
+std::shared_future<OpStatus>
+OperationExecutor::SubmitAsync(OperationsPtr operation, OperationCallbackT cb) {
+    if (!operation) return std::shared_future<OpStatus>();
+    operation->OnFinish(cb);
+    Enqueue(operation);
+    return operation->GetFuture();
+}
+
 void
-OperationExecutor::Start() {
-    if (executor_ || stopped_) return;
-    auto queue = std::make_shared<OperationQueueT>();
-    auto t = std::make_shared<std::thread>(&OperationExecutor::ThreadMain, this, queue);
-    executor_ = std::make_shared<Executor>(t, queue);
-    std::cout << "OperationExecutor Started" << std::endl;
+OperationExecutor::Start(size_t lane_num, const OperationExecutorOptions& options) {
+    if (!executors_.empty() || stopped_) return;
+    if (lane_num == 0) lane_num = 1;
+    options_ = options;
+    if (options_.max_batch_size == 0) options_.max_batch_size = 1;
+    for (size_t i = 0; i < lane_num; ++i) {
+        auto queue = std::make_shared<OperationQueueT>();
+        // Finish callbacks submit follow-up operations from the lane threads themselves,
+        // so putting into a lane must never block
+        queue->SetCapacity(std::numeric_limits<size_t>::max());
+        auto t = std::make_shared<std::thread>(&OperationExecutor::ThreadMain, this, queue);
+        executors_.push_back(std::make_shared<Executor>(t, queue));
+    }
+    std::cout << "OperationExecutor Started with " << lane_num << " lanes" << std::endl;
 }
 
 void
 OperationExecutor::Stop() {
-    if (stopped_ || !executor_) return;
+    if (stopped_ || executors_.empty()) return;
 
-    executor_->execute_queue->Put(nullptr);
-    executor_->execute_thread->join();
+    for (auto& executor : executors_) {
+        executor->execute_queue->Put(nullptr);
+    }
+    for (auto& executor : executors_) {
+        executor->execute_thread->join();
+    }
     stopped_ = true;
-    std::cout << "OperationExecutor Stopped" << std::endl;
+    auto stats = GetStats();
+    std::cout << "OperationExecutor Stopped: " << stats.operations << " operations in " << stats.batches
+              << " batches, max batch size " << stats.max_batch_size << std::endl;
+}
+
+OperationExecutorStats
+OperationExecutor::GetStats() const {
+    OperationExecutorStats stats;
+    stats.batches = batches_;
+    stats.operations = batched_operations_;
+    stats.max_batch_size = max_batch_size_;
+    return stats;
+}
+
+const ExecutorPtr&
+OperationExecutor::GetLane(const OperationsPtr& operation) const {
+    // Operations without a snapshot (loads, hard deletes, id listings) go to the first lane
+    auto& prev_ss = operation->GetPrevSnapshot();
+    if (!prev_ss || executors_.size() == 1) return executors_[0];
+    auto h = std::hash<ID_TYPE>()(prev_ss->GetCollectionId());
+    return executors_[h % executors_.size()];
 }
 
 void
 OperationExecutor::Enqueue(OperationsPtr operation) {
-    executor_->execute_queue->Put(operation);
+    GetLane(operation)->execute_queue->Put(operation);
 }
 
 void
 OperationExecutor::ThreadMain(OperationQueuePtr queue) {
     if (!queue) return;
 
-    while (true) {
+    std::vector<OperationsPtr> batch;
+    bool stopping = false;
+    while (!stopping) {
         OperationsPtr operation = queue->Take();
-        if (!operation) {
-            std::cout << "Stopping operation executor thread " << std::this_thread::get_id() << std::endl;
-            break;
+        if (!operation) break;
+        batch.push_back(operation);
+
+        // Group commit: drain operations queued behind the first one, up to the batch size
+        // and for at most max_batch_delay
+        auto deadline = std::chrono::steady_clock::now() + options_.max_batch_delay;
+        while (batch.size() < options_.max_batch_size) {
+            auto wait = std::chrono::duration_cast<std::chrono::microseconds>(
+                    deadline - std::chrono::steady_clock::now());
+            if (wait.count() < 0) wait = std::chrono::microseconds(0);
+            if (!queue->TryTake(operation, wait)) break;
+            if (!operation) {
+                stopping = true;
+                break;
+            }
+            batch.push_back(operation);
         }
 
-        Store::GetInstance().Apply(*operation);
+        ApplyBatch(batch);
+        batch.clear();
+    }
+    std::cout << "Stopping operation executor thread " << std::this_thread::get_id() << std::endl;
+}
+
+void
+OperationExecutor::ApplyBatch(std::vector<OperationsPtr>& batch) {
+    auto& store = Store::GetInstance();
+    store.StartTransanction();
+    for (auto& operation : batch) {
+        operation->DeferNotify();
+        store.Apply(*operation);
+    }
+    if (!store.FinishTransaction()) {
+        // The store rolled the whole batch back
+        for (auto& operation : batch) {
+            operation->FailCommit(OP_FAIL_FLUSH_META);
+        }
+    }
+    // Waiters only see their operation once the whole batch is committed
+    for (auto& operation : batch) {
+        operation->Notify();
+    }
+
+    ++batches_;
+    batched_operations_ += batch.size();
+    auto max_size = max_batch_size_.load();
+    while (batch.size() > max_size && !max_batch_size_.compare_exchange_weak(max_size, batch.size())) {
     }
 }
 
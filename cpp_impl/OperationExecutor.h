@@ -16,6 +16,9 @@
 #include <thread>
 #include <mutex>
 #include <memory>
+#include <vector>
+#include <atomic>
+#include <chrono>
 
 namespace milvus {
 namespace engine {
@@ -33,6 +36,20 @@ struct Executor {
 
 using ExecutorPtr = std::shared_ptr<Executor>;
 
+struct OperationExecutorOptions {
+    // Max number of queued operations applied in one store transaction
+    size_t max_batch_size = 64;
+    // How long a lane waits for more operations before committing a batch. Zero only
+    // batches what is already queued, so a lone operation never waits
+    std::chrono::microseconds max_batch_delay = std::chrono::microseconds(0);
+};
+
+struct OperationExecutorStats {
+    size_t batches = 0;
+    size_t operations = 0;
+    size_t max_batch_size = 0;
+};
+
 class OperationExecutor {
 public:
     using Ptr = std::shared_ptr<OperationExecutor>;
@@ -43,7 +60,14 @@ public:
 
     bool Submit(OperationsPtr operation);
 
-    void Start();
+    // Enqueue and return without waiting, see Operations::PushAsync
+    std::shared_future<OpStatus> SubmitAsync(OperationsPtr operation, OperationCallbackT cb = nullptr);
+
+    // Operations are spread over `lane_num` lanes by collection id. Operations of the same
+    // collection always go to the same lane and keep their submission order
+    void Start(size_t lane_num = 1, const OperationExecutorOptions& options = OperationExecutorOptions());
+
+    OperationExecutorStats GetStats() const;
 
     void Stop();
 
@@ -54,11 +78,19 @@ protected:
 
     void ThreadMain(OperationQueuePtr queue);
 
+    void ApplyBatch(std::vector<OperationsPtr>& batch);
+
     void Enqueue(OperationsPtr operation);
 
+    const ExecutorPtr& GetLane(const OperationsPtr& operation) const;
+
     mutable std::mutex mtx_;
     bool stopped_ = false;
-    ExecutorPtr executor_;
+    std::vector<ExecutorPtr> executors_;
+    OperationExecutorOptions options_;
+    std::atomic<size_t> batches_ = 0;
+    std::atomic<size_t> batched_operations_ = 0;
+    std::atomic<size_t> max_batch_size_ = 0;
 };
 
 } // snapshot
@@ -33,15 +33,87 @@ bool
 Operations::WaitToFinish() {
     std::unique_lock<std::mutex> lock(finish_mtx_);
     finish_cond_.wait(lock, [this] {
-        return status_ != OP_PENDING;
+        return finished_;
     });
     return true;
 }
 
 void
 Operations::Done() {
-    status_ = OP_OK;
+    {
+        std::unique_lock<std::mutex> lock(finish_mtx_);
+        // Keep a failure set during execution
+        if (status_ == OP_PENDING) status_ = OP_OK;
+        done_ = true;
+        if (defer_notify_) return;
+    }
+    Finish();
+}
+
+void
+Operations::Abort(OpStatus status) {
+    {
+        std::unique_lock<std::mutex> lock(finish_mtx_);
+        if (status_ == OP_PENDING) status_ = status;
+    }
+    Done();
+}
+
+void
+Operations::FailCommit(OpStatus status) {
+    std::unique_lock<std::mutex> lock(finish_mtx_);
+    if (finished_) return;
+    status_ = status;
+    ids_.clear();
+}
+
+void
+Operations::DeferNotify() {
+    std::unique_lock<std::mutex> lock(finish_mtx_);
+    defer_notify_ = true;
+}
+
+void
+Operations::Notify() {
+    {
+        std::unique_lock<std::mutex> lock(finish_mtx_);
+        defer_notify_ = false;
+        if (!done_) return;
+    }
+    Finish();
+}
+
+void
+Operations::Finish() {
+    std::vector<OperationCallbackT> cbs;
+    OpStatus status;
+    {
+        std::unique_lock<std::mutex> lock(finish_mtx_);
+        if (finished_) return;
+        finished_ = true;
+        status = status_;
+        cbs.swap(finish_cbs_);
+    }
     finish_cond_.notify_all();
+    finish_promise_.set_value(status);
+    for (auto& cb : cbs) {
+        cb(status);
+    }
+}
+
+void
+Operations::OnFinish(OperationCallbackT cb) {
+    if (!cb) return;
+    OpStatus status;
+    {
+        std::unique_lock<std::mutex> lock(finish_mtx_);
+        if (!finished_) {
+            finish_cbs_.push_back(cb);
+            return;
+        }
+        status = status_;
+    }
+    cb(status);
 }
 
 void
@@ -50,6 +122,11 @@ Operations::Push() {
     this->WaitToFinish();
 }
 
+std::shared_future<OpStatus>
+Operations::PushAsync(OperationCallbackT cb) {
+    return OperationExecutor::GetInstance().SubmitAsync(shared_from_this(), cb);
+}
+
 bool
 Operations::IsStale() const {
     auto curr_ss = Snapshots::GetInstance().GetSnapshot(prev_ss_->GetCollectionId());
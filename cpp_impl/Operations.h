@@ -16,16 +16,18 @@
 #include "Context.h"
 #include <assert.h>
 #include <vector>
-#include <any>
 #include <mutex>
 #include <thread>
 #include <condition_variable>
+#include <functional>
+#include <future>
 
 namespace milvus {
 namespace engine {
 namespace snapshot {
 
-using StepsT = std::vector<std::any>;
+using StepT = AllResourcesT::PtrT;
+using StepsT = std::vector<StepT>;
 
 enum OpStatus {
     OP_PENDING = 0,
@@ -38,6 +40,10 @@ enum OpStatus {
     OP_FAIL_FLUSH_META
 };
 
+// Called once an operation has finished, on the executor lane that ran it. Keep it short:
+// it may submit follow-up operations but must not wait for them
+using OperationCallbackT = std::function<void(OpStatus)>;
+
 class Operations : public std::enable_shared_from_this<Operations> {
 public:
     /* static constexpr const char* Name = Derived::Name; */
@@ -48,8 +54,9 @@ public:
 
     virtual bool IsStale() const;
 
-    template<typename StepT>
-    void AddStep(const StepT& step);
+    // The store adopts a step as is, so the resource must not be shared with anyone who
+    // changes it afterwards
+    void AddStep(StepT step) { steps_.push_back(std::move(step)); }
     void SetStepResult(ID_TYPE id) { ids_.push_back(id); }
 
     StepsT& GetSteps() { return steps_; }
@@ -63,6 +70,9 @@ public:
 
     virtual void operator()(Store& store);
     virtual void Push();
+    // Submit without blocking. `cb` runs when the operation finishes and the returned
+    // future is ready at the same time
+    virtual std::shared_future<OpStatus> PushAsync(OperationCallbackT cb = nullptr);
 
     virtual void ApplyToStore(Store& store);
 
@@ -70,6 +80,21 @@ public:
 
     void Done();
 
+    // Group commit: hold back waking up waiters until the batch transaction has finished.
+    // DeferNotify is called before the operation is applied and Notify after the commit
+    void DeferNotify();
+    void Notify();
+
+    // Register a finish callback. Runs immediately if the operation has already finished
+    void OnFinish(OperationCallbackT cb);
+    const std::shared_future<OpStatus>& GetFuture() const { return finish_future_; }
+
+    // Finish without executing, e.g. when an asynchronous step it depends on failed
+    void Abort(OpStatus status);
+    // The transaction the operation was applied in failed to commit: report `status` and no
+    // results. Called between DeferNotify and Notify
+    void FailCommit(OpStatus status);
+
     virtual ~Operations() {}
 
 protected:
@@ -78,15 +103,18 @@ protected:
     StepsT steps_;
     std::vector<ID_TYPE> ids_;
     OpStatus status_ = OP_PENDING;
+    bool done_ = false;
+    bool defer_notify_ = false;
+    bool finished_ = false;
     mutable std::mutex finish_mtx_;
     std::condition_variable finish_cond_;
-};
+    std::vector<OperationCallbackT> finish_cbs_;
+    std::promise<OpStatus> finish_promise_;
+    std::shared_future<OpStatus> finish_future_ = finish_promise_.get_future().share();
 
-template<typename StepT>
-void
-Operations::AddStep(const StepT& step) {
-    steps_.push_back(std::make_shared<StepT>(step));
-}
+private:
+    void Finish();
+};
 
 template <typename ResourceT>
 class CommitOperation : public Operations {
@@ -103,8 +131,8 @@ public:
 
     typename ResourceT::Ptr GetResource() const  {
         if (status_ == OP_PENDING) return nullptr;
+        // resource_ is the step the store adopted, so it already carries its id
         if (ids_.size() == 0) return nullptr;
-        resource_->SetID(ids_[0]);
         return resource_;
     }
 
@@ -137,25 +165,50 @@ protected:
     typename ResourceT::Ptr resource_;
 };
 
+// Load many resources of one type in a single store pass, e.g. all segment files a snapshot
+// refers to. Results are in the order of `context.ids`, nullptr where there is none
+template <typename ResourceT>
+class LoadResourcesOperation : public Operations {
+public:
+    LoadResourcesOperation(const LoadOperationContext& context) :
+       Operations(OperationContext(), ScopedSnapshotT()), context_(context) {}
+
+    void ApplyToStore(Store& store) override {
+        if (status_ != OP_PENDING) return;
+        resources_ = store.GetResources<ResourceT>(context_.ids);
+        Done();
+    }
+
+    const typename ResourceT::VecT& GetResources() const {
+        return resources_;
+    }
+
+protected:
+    LoadOperationContext context_;
+    typename ResourceT::VecT resources_;
+};
+
 template <typename ResourceT>
 class HardDeleteOperation : public Operations {
 public:
     HardDeleteOperation(ID_TYPE id) :
-       Operations(OperationContext(), ScopedSnapshotT()), id_(id) {}
+       Operations(OperationContext(), ScopedSnapshotT()), delete_ids_({id}) {}
+    HardDeleteOperation(const IDS_TYPE& ids) :
+       Operations(OperationContext(), ScopedSnapshotT()), delete_ids_(ids) {}
 
     void ApplyToStore(Store& store) override {
         if (status_ != OP_PENDING) return;
-        ok_ = store.RemoveResource<ResourceT>(id_);
+        ok_ = store.RemoveResources<ResourceT>(delete_ids_);
         Done();
     }
 
     bool GetStatus() const  {
-        if (status_ == OP_PENDING) return false;
+        if (status_ != OP_OK) return false;
         return ok_;
     }
 
 protected:
-    ID_TYPE id_;
+    IDS_TYPE delete_ids_;
     // PXU TODO: Replace all bool to Status type
     bool ok_;
 };
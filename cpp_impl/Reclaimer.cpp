@@ -0,0 +1,126 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include "Reclaimer.h"
+#include <iostream>
+#include <limits>
+#include <algorithm>
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+Reclaimer::Reclaimer() {
+    // Submitters are reader threads dropping their last reference: never block them
+    queue_.SetCapacity(std::numeric_limits<size_t>::max());
+}
+
+Reclaimer::~Reclaimer() {
+    Stop();
+}
+
+Reclaimer&
+Reclaimer::GetInstance() {
+    static Reclaimer reclaimer;
+    return reclaimer;
+}
+
+void
+Reclaimer::Submit(OnNoRefCBF cb) {
+    if (!cb) return;
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (running_) {
+            queue_.Put(cb);
+            return;
+        }
+    }
+    cb();
+}
+
+void
+Reclaimer::HardDeleteInBatches(const IDS_TYPE& ids, const std::function<size_t(const IDS_TYPE&)>& fn) {
+    ReclaimerOptions options;
+    bool throttle;
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        options = options_;
+        throttle = running_ && thread_ && std::this_thread::get_id() == thread_->get_id();
+    }
+    auto batch_size = std::max<size_t>(options.max_batch_size, 1);
+    for (size_t pos = 0; pos < ids.size(); pos += batch_size) {
+        IDS_TYPE batch(ids.begin() + pos, ids.begin() + std::min(pos + batch_size, ids.size()));
+        auto deleted = fn(batch);
+        if (deleted == 0) continue;
+        ++batches_;
+        hard_deletes_ += deleted;
+        if (throttle && options.batch_interval.count() > 0) {
+            std::this_thread::sleep_for(options.batch_interval);
+        }
+    }
+}
+
+ReclaimerStats
+Reclaimer::GetStats() const {
+    ReclaimerStats stats;
+    stats.batches = batches_;
+    stats.hard_deletes = hard_deletes_;
+    return stats;
+}
+
+void
+Reclaimer::Start(const ReclaimerOptions& options) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (running_ || stopped_) return;
+    options_ = options;
+    thread_ = std::make_shared<std::thread>(&Reclaimer::ThreadMain, this);
+    running_ = true;
+    std::cout << "Reclaimer Started" << std::endl;
+}
+
+void
+Reclaimer::Stop() {
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (!running_) return;
+        queue_.Put(nullptr);
+    }
+    thread_->join();
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        running_ = false;
+        stopped_ = true;
+    }
+    // Callbacks run by the thread may have released more resources behind the stop marker
+    while (!queue_.Empty()) {
+        auto cb = queue_.Take();
+        if (cb) cb();
+    }
+    auto stats = GetStats();
+    std::cout << "Reclaimer Stopped: " << stats.hard_deletes << " hard deletes in " << stats.batches
+              << " batches" << std::endl;
+}
+
+void
+Reclaimer::ThreadMain() {
+    while (true) {
+        auto cb = queue_.Take();
+        if (!cb) {
+            std::cout << "Stopping reclaimer thread " << std::this_thread::get_id() << std::endl;
+            break;
+        }
+        cb();
+    }
+}
+
+} // snapshot
+} // engine
+} // milvus
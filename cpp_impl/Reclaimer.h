@@ -0,0 +1,81 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+#include "ReferenceProxy.h"
+#include "ResourceTypes.h"
+#include "utils/BlockingQueue.h"
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <chrono>
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+// Runs no-ref callbacks (hard deletes, snapshot releases) on a dedicated thread so that the
+// thread dropping the last reference never does the reclamation work itself.
+// Before Start and after Stop callbacks are run inline by the submitter.
+struct ReclaimerOptions {
+    // Max number of resources removed by one hard delete operation
+    size_t max_batch_size = 1024;
+    // Pause of the reclaimer thread after each hard delete operation, so that reclaiming a
+    // large retired snapshot leaves the executor to foreground commits in between
+    std::chrono::microseconds batch_interval = std::chrono::microseconds(1000);
+};
+
+struct ReclaimerStats {
+    size_t batches = 0;
+    size_t hard_deletes = 0;
+};
+
+class Reclaimer {
+public:
+    using CallbackQueueT = server::BlockingQueue<OnNoRefCBF>;
+
+    Reclaimer(const Reclaimer&) = delete;
+
+    static Reclaimer& GetInstance();
+
+    void Submit(OnNoRefCBF cb);
+
+    // Split `ids` by the max batch size and call `fn` on each part, pausing in between when
+    // called on the reclaimer thread. `fn` returns how many ids of the part it deleted
+    void HardDeleteInBatches(const IDS_TYPE& ids, const std::function<size_t(const IDS_TYPE&)>& fn);
+
+    void Start(const ReclaimerOptions& options = ReclaimerOptions());
+
+    ReclaimerStats GetStats() const;
+
+    void Stop();
+
+    ~Reclaimer();
+
+protected:
+    Reclaimer();
+
+    void ThreadMain();
+
+    mutable std::mutex mtx_;
+    ReclaimerOptions options_;
+    std::atomic<size_t> batches_ = 0;
+    std::atomic<size_t> hard_deletes_ = 0;
+    bool running_ = false;
+    bool stopped_ = false;
+    std::shared_ptr<std::thread> thread_;
+    CallbackQueueT queue_;
+};
+
+} // snapshot
+} // engine
+} // milvus
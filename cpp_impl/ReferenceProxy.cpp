@@ -10,6 +10,7 @@
 // or implied. See the License for the specific language governing permissions and limitations under the License.
 
 #include "ReferenceProxy.h"
+#include "Reclaimer.h"
 #include <assert.h>
 #include <iostream>
 
@@ -18,19 +19,45 @@ namespace engine {
 namespace snapshot {
 
 
+// References and no-ref callbacks belong to an object, not to its value: a copy of a resource,
+// e.g. a new commit derived from the previous one, starts unreferenced
+ReferenceProxy::ReferenceProxy(const ReferenceProxy&) {
+}
+
+ReferenceProxy&
+ReferenceProxy::operator=(const ReferenceProxy&) {
+    return *this;
+}
+
 void ReferenceProxy::Ref() {
-    refcnt_ += 1;
+    // Taking a new reference requires already holding one, so no ordering is needed here
+    refcnt_.fetch_add(1, std::memory_order_relaxed);
     /* std::cout << this << " refcnt = " << refcnt_ << std::endl; */
 }
 
+bool ReferenceProxy::TryRef() {
+    auto cnt = refcnt_.load(std::memory_order_relaxed);
+    do {
+        if (cnt == 0) return false;
+    } while (!refcnt_.compare_exchange_weak(cnt, cnt + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+    return true;
+}
+
 void ReferenceProxy::UnRef() {
-    if (refcnt_ == 0) return;
-    refcnt_ -= 1;
+    // Readers may Ref/UnRef concurrently (e.g. lock-free snapshot reads), so the
+    // decrement must never go below zero and only one caller may observe 1 -> 0
+    auto cnt = refcnt_.load(std::memory_order_relaxed);
+    do {
+        if (cnt == 0) return;
+    } while (!refcnt_.compare_exchange_weak(cnt, cnt - 1, std::memory_order_acq_rel, std::memory_order_relaxed));
     /* std::cout << this << " refcnt = " << refcnt_ << std::endl; */
-    if (refcnt_ == 0) {
-        for (auto& cb : on_no_ref_cbs_) {
-            cb();
-        }
+    if (cnt == 1 && !on_no_ref_cbs_.empty()) {
+        auto cbs = on_no_ref_cbs_;
+        Reclaimer::GetInstance().Submit([cbs]() {
+            for (auto& cb : cbs) {
+                cb();
+            }
+        });
     }
 }
 
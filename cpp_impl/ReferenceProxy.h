@@ -14,6 +14,7 @@
 #include <vector>
 #include <memory>
 #include <any>
+#include <atomic>
 
 namespace milvus {
 namespace engine {
@@ -23,10 +24,18 @@ using OnNoRefCBF = std::function<void(void)>;
 
 class ReferenceProxy {
 public:
+    ReferenceProxy() = default;
+    ReferenceProxy(const ReferenceProxy& o);
+    ReferenceProxy& operator=(const ReferenceProxy& o);
+
     void RegisterOnNoRefCB(OnNoRefCBF cb);
+    bool HasOnNoRefCB() const { return !on_no_ref_cbs_.empty(); }
 
     virtual void Ref();
     virtual void UnRef();
+    // Ref only if a reference is still held, i.e. the no-ref callbacks have not been triggered.
+    // Lets a reader that found the object without holding a reference pin it safely
+    bool TryRef();
 
     int RefCnt() const { return refcnt_; }
 
@@ -36,7 +45,7 @@ public:
 
 protected:
 
-    int refcnt_ = 0;
+    std::atomic<int> refcnt_ = 0;
     std::vector<OnNoRefCBF> on_no_ref_cbs_;
 };
 
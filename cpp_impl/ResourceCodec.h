@@ -0,0 +1,286 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+#include "Resources.h"
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <memory>
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+// Fixed width integers are written in host byte order: the log is local to the node
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::string& buffer) : buffer_(buffer) {}
+
+    template <typename T>
+    void Write(T value) {
+        static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "integral types only");
+        buffer_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    // LEB128: 7 bits per byte, small values take one byte
+    void WriteVarint(uint64_t value) {
+        while (value >= 0x80) {
+            buffer_.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        buffer_.push_back(static_cast<char>(value));
+    }
+
+    void WriteString(const std::string& value) {
+        Write<uint32_t>(value.size());
+        buffer_.append(value);
+    }
+
+private:
+    std::string& buffer_;
+};
+
+class BinaryReader {
+public:
+    BinaryReader(const char* data, size_t size) : data_(data), size_(size) {}
+
+    template <typename T>
+    T Read() {
+        T value = T();
+        if (!Require(sizeof(T))) return value;
+        memcpy(&value, data_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return value;
+    }
+
+    uint64_t ReadVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (!Require(1)) return 0;
+            auto byte = static_cast<uint8_t>(data_[pos_++]);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        ok_ = false;
+        return 0;
+    }
+
+    std::string ReadString() {
+        auto size = Read<uint32_t>();
+        if (!Require(size)) return std::string();
+        std::string value(data_ + pos_, size);
+        pos_ += size;
+        return value;
+    }
+
+    // The next `size` bytes in place, nullptr if there are not enough
+    const char* Skip(size_t size) {
+        if (!Require(size)) return nullptr;
+        auto data = data_ + pos_;
+        pos_ += size;
+        return data;
+    }
+
+    bool Ok() const { return ok_; }
+    bool Done() const { return pos_ >= size_; }
+
+private:
+    bool Require(size_t n) {
+        if (ok_ && size_ - pos_ >= n) return true;
+        ok_ = false;
+        return false;
+    }
+
+    const char* data_;
+    size_t size_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+// One specialization per field class. ValueT is the matching resource constructor argument
+template <typename FieldT>
+struct FieldCodec;
+
+template <>
+struct FieldCodec<IdField> {
+    using ValueT = ID_TYPE;
+    static void Encode(BinaryWriter& w, const IdField& f) { w.Write(f.GetID()); }
+    static ValueT Decode(BinaryReader& r) { return r.Read<ValueT>(); }
+};
+
+template <>
+struct FieldCodec<CollectionIdField> {
+    using ValueT = ID_TYPE;
+    static void Encode(BinaryWriter& w, const CollectionIdField& f) { w.Write(f.GetCollectionId()); }
+    static ValueT Decode(BinaryReader& r) { return r.Read<ValueT>(); }
+};
+
+template <>
+struct FieldCodec<SchemaIdField> {
+    using ValueT = ID_TYPE;
+    static void Encode(BinaryWriter& w, const SchemaIdField& f) { w.Write(f.GetSchemaId()); }
+    static ValueT Decode(BinaryReader& r) { return r.Read<ValueT>(); }
+};
+
+template <>
+struct FieldCodec<FieldIdField> {
+    using ValueT = ID_TYPE;
+    static void Encode(BinaryWriter& w, const FieldIdField& f) { w.Write(f.GetFieldId()); }
+    static ValueT Decode(BinaryReader& r) { return r.Read<ValueT>(); }
+};
+
+template <>
+struct FieldCodec<FieldElementIdField> {
+    using ValueT = ID_TYPE;
+    static void Encode(BinaryWriter& w, const FieldElementIdField& f) { w.Write(f.GetFieldElementId()); }
+    static ValueT Decode(BinaryReader& r) { return r.Read<ValueT>(); }
+};
+
+template <>
+struct FieldCodec<PartitionIdField> {
+    using ValueT = ID_TYPE;
+    static void Encode(BinaryWriter& w, const PartitionIdField& f) { w.Write(f.GetPartitionId()); }
+    static ValueT Decode(BinaryReader& r) { return r.Read<ValueT>(); }
+};
+
+template <>
+struct FieldCodec<SegmentIdField> {
+    using ValueT = ID_TYPE;
+    static void Encode(BinaryWriter& w, const SegmentIdField& f) { w.Write(f.GetSegmentId()); }
+    static ValueT Decode(BinaryReader& r) { return r.Read<ValueT>(); }
+};
+
+template <>
+struct FieldCodec<NumField> {
+    using ValueT = NUM_TYPE;
+    static void Encode(BinaryWriter& w, const NumField& f) { w.Write(f.GetNum()); }
+    static ValueT Decode(BinaryReader& r) { return r.Read<ValueT>(); }
+};
+
+template <>
+struct FieldCodec<FtypeField> {
+    using ValueT = FTYPE_TYPE;
+    static void Encode(BinaryWriter& w, const FtypeField& f) { w.Write(f.GetFtype()); }
+    static ValueT Decode(BinaryReader& r) { return r.Read<ValueT>(); }
+};
+
+template <>
+struct FieldCodec<CreatedOnField> {
+    using ValueT = TS_TYPE;
+    static void Encode(BinaryWriter& w, const CreatedOnField& f) { w.Write(f.GetCreatedTime()); }
+    static ValueT Decode(BinaryReader& r) { return r.Read<ValueT>(); }
+};
+
+template <>
+struct FieldCodec<StatusField> {
+    using ValueT = State;
+    static void Encode(BinaryWriter& w, const StatusField& f) { w.Write<int32_t>(f.GetStatus()); }
+    static ValueT Decode(BinaryReader& r) { return static_cast<State>(r.Read<int32_t>()); }
+};
+
+template <>
+struct FieldCodec<NameField> {
+    using ValueT = std::string;
+    static void Encode(BinaryWriter& w, const NameField& f) { w.WriteString(f.GetName()); }
+    static ValueT Decode(BinaryReader& r) { return r.ReadString(); }
+};
+
+template <>
+struct FieldCodec<MappingsField> {
+    using ValueT = MappingT;
+    static void Encode(BinaryWriter& w, const MappingsField& f) { EncodeIds(w, f.GetMappings()); }
+    static ValueT Decode(BinaryReader& r) { return DecodeIds(r); }
+
+    // Ids are sorted and mostly close together: store the gaps as varints
+    static void EncodeIds(BinaryWriter& w, const MappingT& ids) {
+        w.WriteVarint(ids.size());
+        ID_TYPE prev = 0;
+        for (auto id : ids) {
+            w.WriteVarint(static_cast<uint64_t>(id - prev));
+            prev = id;
+        }
+    }
+    static MappingT DecodeIds(BinaryReader& r) {
+        IDS_TYPE ids;
+        auto size = r.ReadVarint();
+        ID_TYPE prev = 0;
+        for (uint64_t i = 0; i < size && r.Ok(); ++i) {
+            prev += static_cast<ID_TYPE>(r.ReadVarint());
+            ids.push_back(prev);
+        }
+        return MappingT(ids.begin(), ids.end());
+    }
+};
+
+// A delta depth of 0 marks full mappings. A delta decodes without its mappings, which the
+// store rebuilds from the parent commit
+template <>
+struct FieldCodec<DeltaMappingsField> {
+    using ValueT = DeltaMappingsField;
+    static void Encode(BinaryWriter& w, const DeltaMappingsField& f) {
+        if (!f.IsDelta()) {
+            w.WriteVarint(0);
+            FieldCodec<MappingsField>::EncodeIds(w, f.GetMappings());
+            return;
+        }
+        w.WriteVarint(f.GetDeltaDepth());
+        w.Write(f.GetParentCommitId());
+        w.Write(f.GetBaseCommitId());
+        FieldCodec<MappingsField>::EncodeIds(w, f.GetRemovedMappings());
+        FieldCodec<MappingsField>::EncodeIds(w, f.GetAddedMappings());
+    }
+    static ValueT Decode(BinaryReader& r) {
+        auto delta_depth = static_cast<NUM_TYPE>(r.ReadVarint());
+        if (delta_depth == 0) return DeltaMappingsField(FieldCodec<MappingsField>::DecodeIds(r));
+        auto parent_commit_id = r.Read<ID_TYPE>();
+        auto base_commit_id = r.Read<ID_TYPE>();
+        auto removed = FieldCodec<MappingsField>::DecodeIds(r);
+        auto added = FieldCodec<MappingsField>::DecodeIds(r);
+        return DeltaMappingsField(parent_commit_id, base_commit_id, delta_depth, removed, added);
+    }
+};
+
+template <typename BaseT>
+struct ResourceFieldsCodec;
+
+template <typename ...Fields>
+struct ResourceFieldsCodec<DBBaseResource<Fields...>> {
+    template <typename ResourceT>
+    static void Encode(BinaryWriter& w, const ResourceT& resource) {
+        (FieldCodec<Fields>::Encode(w, resource), ...);
+    }
+
+    // Every resource constructor takes its fields in declaration order
+    template <typename ResourceT>
+    static std::shared_ptr<ResourceT> Decode(BinaryReader& r) {
+        // Braced initialization evaluates the decoders left to right
+        std::tuple<typename FieldCodec<Fields>::ValueT...> values{FieldCodec<Fields>::Decode(r)...};
+        if (!r.Ok()) return nullptr;
+        return std::apply([](auto&&... args) { return std::make_shared<ResourceT>(args...); }, values);
+    }
+};
+
+// Binary encoding of a resource, derived from its DBBaseResource field list
+template <typename ResourceT>
+struct ResourceCodec {
+    static void Encode(BinaryWriter& w, const ResourceT& resource) {
+        ResourceFieldsCodec<typename ResourceT::BaseT>::Encode(w, resource);
+    }
+
+    static std::shared_ptr<ResourceT> Decode(BinaryReader& r) {
+        return ResourceFieldsCodec<typename ResourceT::BaseT>::template Decode<ResourceT>(r);
+    }
+};
+
+} // snapshot
+} // engine
+} // milvus
@@ -24,56 +24,68 @@ CollectionsHolder::Load(const std::string& name) {
     context.name = name;
     auto op = std::make_shared<LoadOperation<Collection>>(context);
     op->Push();
-    auto c = op->GetResource();
-    if (c) {
-        BaseT::AddNoLock(c);
-        return c;
-    }
-    return nullptr;
+    return op->GetResource();
 }
 
 CollectionsHolder::ScopedT
 CollectionsHolder::GetCollection(const std::string& name, bool scoped) {
-    std::unique_lock<std::mutex> lock(BaseT::mutex_);
-    auto cit = name_map_.find(name);
-    if (cit == name_map_.end()) {
-        auto ret = Load(name);
-        if (!ret) return BaseT::ScopedT();
-        return BaseT::ScopedT(ret, scoped);
+    {
+        std::unique_lock<std::mutex> lock(name_mutex_);
+        auto cit = name_map_.find(name);
+        if (cit != name_map_.end()) {
+            return BaseT::ScopedT(cit->second, scoped);
+        }
     }
-    return BaseT::ScopedT(cit->second, scoped);
+    auto ret = Load(name);
+    if (!ret) return BaseT::ScopedT();
+    Add(ret);
+    return GetResource(ret->GetID(), scoped);
 }
 
 bool CollectionsHolder::Add(CollectionsHolder::ResourcePtr resource) {
-    if (!resource) return false;
-    std::unique_lock<std::mutex> lock(BaseT::mutex_);
-    return BaseT::AddNoLock(resource);
+    if (!BaseT::Add(resource)) return false;
+    std::unique_lock<std::mutex> lock(name_mutex_);
+    name_map_[resource->GetName()] = resource;
+    return true;
 }
 
 bool CollectionsHolder::Release(const std::string& name) {
-    std::unique_lock<std::mutex> lock(BaseT::mutex_);
-    auto it = name_map_.find(name);
-    if (it == name_map_.end()) {
-        return false;
+    ID_TYPE id;
+    {
+        std::unique_lock<std::mutex> lock(name_mutex_);
+        auto it = name_map_.find(name);
+        if (it == name_map_.end()) {
+            return false;
+        }
+        id = it->second->GetID();
     }
-
-    BaseT::id_map_.erase(it->second->GetID());
-    name_map_.erase(it);
-    return true;
+    return Release(id);
 }
 
 bool CollectionsHolder::Release(ID_TYPE id) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    auto it = id_map_.find(id);
-    if (it == id_map_.end()) {
-        return false;
+    ResourcePtr resource;
+    {
+        auto& stripe = GetStripe(id);
+        std::unique_lock<std::mutex> lock(stripe.mutex_);
+        resource = RemoveNoLock(stripe, id);
     }
-
-    BaseT::id_map_.erase(it);
-    name_map_.erase(it->second->GetName());
+    if (!resource) return false;
+    RemoveName(resource);
     return true;
 }
 
+void CollectionsHolder::OnEvicted(CollectionsHolder::ResourcePtr resource) {
+    RemoveName(resource);
+}
+
+void CollectionsHolder::RemoveName(CollectionsHolder::ResourcePtr resource) {
+    std::unique_lock<std::mutex> lock(name_mutex_);
+    auto it = name_map_.find(resource->GetName());
+    if (it != name_map_.end() && it->second == resource) {
+        name_map_.erase(it);
+    }
+}
+
 } // snapshot
 } // engine
 } // milvus
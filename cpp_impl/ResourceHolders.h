@@ -30,7 +30,11 @@ public:
 
 private:
     ResourcePtr Load(const std::string& name) override;
+    void OnEvicted(ResourcePtr resource) override;
+    void RemoveName(ResourcePtr resource);
 
+    // Apart from the id stripes. Never held while taking a stripe lock
+    std::mutex name_mutex_;
     NameMapT name_map_;
 };
 
@@ -21,16 +21,19 @@ CollectionCommitOperation::DoExecute(Store& store) {
     if (!prev_resource) return false;
     resource_ = std::make_shared<CollectionCommit>(*prev_resource);
     resource_->ResetStatus();
+    IDS_TYPE removed;
+    IDS_TYPE added;
     if (context_.new_partition_commit) {
         auto prev_partition_commit = prev_ss_->GetPartitionCommitByPartitionId(
                 context_.new_partition_commit->GetPartitionId());
-        resource_->GetMappings().erase(prev_partition_commit->GetID());
-        resource_->GetMappings().insert(context_.new_partition_commit->GetID());
+        removed.push_back(prev_partition_commit->GetID());
+        added.push_back(context_.new_partition_commit->GetID());
     } else if (context_.new_schema_commit) {
         resource_->SetSchemaId(context_.new_schema_commit->GetID());
     }
+    resource_->EditMappings(prev_resource->GetID(), std::move(removed), std::move(added));
     resource_->SetID(0);
-    AddStep(*BaseT::resource_);
+    AddStep(BaseT::resource_);
     return true;
 }
 
@@ -57,21 +60,23 @@ PartitionCommitOperation::DoExecute(Store& store) {
         resource_->ResetStatus();
         auto prev_segment_commit = prev_ss_->GetSegmentCommit(
                 context_.new_segment_commit->GetSegmentId());
+        IDS_TYPE removed;
         if (prev_segment_commit)
-            resource_->GetMappings().erase(prev_segment_commit->GetID());
+            removed.push_back(prev_segment_commit->GetID());
         if (context_.stale_segments.size() > 0) {
             for (auto& stale_segment : context_.stale_segments) {
                 auto stale_segment_commit = prev_ss_->GetSegmentCommit(stale_segment->GetID());
-                resource_->GetMappings().erase(stale_segment_commit->GetID());
+                removed.push_back(stale_segment_commit->GetID());
             }
         }
+        resource_->EditMappings(prev_resource->GetID(), std::move(removed), {context_.new_segment_commit->GetID()});
     } else {
         resource_ = std::make_shared<PartitionCommit>(prev_ss_->GetCollectionId(),
-                                                      context_.new_segment_commit->GetPartitionId());
+                                                      context_.new_segment_commit->GetPartitionId(),
+                                                      MappingT{context_.new_segment_commit->GetID()});
     }
 
-    resource_->GetMappings().insert(context_.new_segment_commit->GetID());
-    AddStep(*resource_);
+    AddStep(resource_);
     return true;
 }
 
@@ -106,7 +111,7 @@ SegmentOperation::DoExecute(Store& store) {
     }
     auto prev_num = prev_ss_->GetMaxSegmentNumByPartition(context_.prev_partition->GetID());
     resource_ = std::make_shared<Segment>(context_.prev_partition->GetID(), prev_num+1);
-    AddStep(*resource_);
+    AddStep(resource_);
     return true;
 }
 
@@ -114,22 +119,26 @@ bool
 SegmentCommitOperation::DoExecute(Store& store) {
     auto prev_resource = GetPrevResource();
 
+    IDS_TYPE added;
+    for(auto& new_segment_file : context_.new_segment_files) {
+        added.push_back(new_segment_file->GetID());
+    }
     if (prev_resource) {
         resource_ = std::make_shared<SegmentCommit>(*prev_resource);
         resource_->SetID(0);
         resource_->ResetStatus();
+        IDS_TYPE removed;
         if (context_.stale_segment_file) {
-            resource_->GetMappings().erase(context_.stale_segment_file->GetID());
+            removed.push_back(context_.stale_segment_file->GetID());
         }
+        resource_->GetMappings().Edit(std::move(removed), std::move(added));
     } else {
         resource_ = std::make_shared<SegmentCommit>(prev_ss_->GetLatestSchemaCommitId(),
                                                     context_.new_segment_files[0]->GetPartitionId(),
-                                                    context_.new_segment_files[0]->GetSegmentId());
-    }
-    for(auto& new_segment_file : context_.new_segment_files) {
-        resource_->GetMappings().insert(new_segment_file->GetID());
+                                                    context_.new_segment_files[0]->GetSegmentId(),
+                                                    MappingT(added.begin(), added.end()));
     }
-    AddStep(*resource_);
+    AddStep(resource_);
     return true;
 }
 
@@ -145,10 +154,40 @@ bool
 SegmentFileOperation::DoExecute(Store& store) {
     auto field_element_id = prev_ss_->GetFieldElementId(context_.field_name, context_.field_element_name);
     resource_ = std::make_shared<SegmentFile>(context_.partition_id, context_.segment_id, field_element_id);
-    AddStep(*resource_);
+    AddStep(resource_);
     return true;
 }
 
+SegmentFilesOperation::SegmentFilesOperation(const std::vector<SegmentFileContext>& contexts,
+        ScopedSnapshotT prev_ss)
+    : BaseT(OperationContext(), prev_ss), contexts_(contexts) {
+}
+
+SegmentFilesOperation::SegmentFilesOperation(const std::vector<SegmentFileContext>& contexts,
+        ID_TYPE collection_id, ID_TYPE commit_id)
+    : BaseT(OperationContext(), collection_id, commit_id), contexts_(contexts) {
+}
+
+bool
+SegmentFilesOperation::DoExecute(Store& store) {
+    if (contexts_.size() == 0) return false;
+    for (auto& context : contexts_) {
+        auto field_element_id = prev_ss_->GetFieldElementId(context.field_name, context.field_element_name);
+        if (field_element_id == 0) return false;
+        auto resource = std::make_shared<SegmentFile>(context.partition_id, context.segment_id, field_element_id);
+        resources_.push_back(resource);
+        AddStep(resource);
+    }
+    return true;
+}
+
+SegmentFile::VecT
+SegmentFilesOperation::GetResources() const {
+    if (status_ == OP_PENDING) return SegmentFile::VecT();
+    if (ids_.size() != resources_.size()) return SegmentFile::VecT();
+    return resources_;
+}
+
 } // snapshot
 } // engine
 } // milvus
@@ -83,6 +83,25 @@ protected:
     SegmentFileContext context_;
 };
 
+/*
+ * One segment file per context, all committed by one operation in one store transaction
+ */
+class SegmentFilesOperation : public Operations {
+public:
+    using BaseT = Operations;
+    SegmentFilesOperation(const std::vector<SegmentFileContext>& contexts, ScopedSnapshotT prev_ss);
+    SegmentFilesOperation(const std::vector<SegmentFileContext>& contexts, ID_TYPE collection_id,
+            ID_TYPE commit_id = 0);
+
+    bool DoExecute(Store& store) override;
+
+    SegmentFile::VecT GetResources() const;
+
+protected:
+    std::vector<SegmentFileContext> contexts_;
+    SegmentFile::VecT resources_;
+};
+
 template <>
 class LoadOperation<Collection> : public Operations {
 public:
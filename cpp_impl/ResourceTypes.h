@@ -11,6 +11,8 @@
 
 #pragma once
 
+#include "utils/FlatSet.h"
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <set>
@@ -23,7 +25,7 @@ using ID_TYPE = int64_t;
 using NUM_TYPE = int64_t;
 using FTYPE_TYPE = int64_t;
 using TS_TYPE = int64_t;
-using MappingT = std::set<ID_TYPE>;
+using MappingT = milvus::server::FlatSet<ID_TYPE>;
 
 using IDS_TYPE = std::vector<ID_TYPE>;
 
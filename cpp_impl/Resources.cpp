@@ -18,6 +18,56 @@ namespace milvus {
 namespace engine {
 namespace snapshot {
 
+void
+DeltaMappingsField::EditMappings(ID_TYPE parent_id, IDS_TYPE removed, IDS_TYPE added) {
+    // Keep only the ids that change: an id both removed and added stays
+    MappingT added_set(added.begin(), added.end());
+    IDS_TYPE removed_ids;
+    IDS_TYPE added_ids;
+    for (auto id : removed) {
+        if (mappings_.count(id) > 0 && added_set.count(id) == 0) removed_ids.push_back(id);
+    }
+    for (auto id : added_set) {
+        if (mappings_.count(id) == 0) added_ids.push_back(id);
+    }
+    mappings_.Edit(std::move(removed), std::move(added));
+    removed_ = MappingT(removed_ids.begin(), removed_ids.end());
+    added_ = MappingT(added_ids.begin(), added_ids.end());
+
+    // The fields were copied from the parent, so they still describe its place in the chain
+    auto base_commit_id = base_commit_id_ > 0 ? base_commit_id_ : parent_id;
+    auto delta_depth = delta_depth_ + 1;
+    parent_commit_id_ = parent_id;
+    if (delta_depth > max_delta_depth_ || removed_.size() + added_.size() >= mappings_.size()) {
+        base_commit_id_ = 0;
+        delta_depth_ = 0;
+    } else {
+        base_commit_id_ = base_commit_id;
+        delta_depth_ = delta_depth;
+    }
+}
+
+void
+DeltaMappingsField::DiffMappings(ID_TYPE parent_id, const MappingT& parent_mappings,
+        IDS_TYPE& added, IDS_TYPE& removed) const {
+    if (parent_id > 0 && parent_id == parent_commit_id_) {
+        added.assign(added_.begin(), added_.end());
+        removed.assign(removed_.begin(), removed_.end());
+        return;
+    }
+    for (auto id : mappings_) {
+        if (parent_mappings.count(id) == 0) added.push_back(id);
+    }
+    for (auto id : parent_mappings) {
+        if (mappings_.count(id) == 0) removed.push_back(id);
+    }
+}
+
+void
+DeltaMappingsField::Materialize(const MappingT& parent_mappings) {
+    mappings_ = parent_mappings;
+    mappings_.Edit(IDS_TYPE(removed_.begin(), removed_.end()), IDS_TYPE(added_.begin(), added_.end()));
+}
 
 Collection::Collection(const std::string& name, ID_TYPE id, State status, TS_TYPE created_on) :
     BaseT(name, id, status, created_on) {
@@ -44,7 +94,7 @@ FieldElement::FieldElement(ID_TYPE collection_id, ID_TYPE field_id, const std::s
 }
 
 CollectionCommit::CollectionCommit(ID_TYPE collection_id, ID_TYPE schema_id,
-        const MappingT& mappings, ID_TYPE id, State status, TS_TYPE created_on) :
+        const DeltaMappingsField& mappings, ID_TYPE id, State status, TS_TYPE created_on) :
     BaseT(collection_id, schema_id, mappings, id, status, created_on) {
 }
 
@@ -69,7 +119,7 @@ Partition::Partition(const std::string& name, ID_TYPE collection_id, ID_TYPE id,
 }
 
 PartitionCommit::PartitionCommit(ID_TYPE collection_id, ID_TYPE partition_id,
-        const MappingT& mappings, ID_TYPE id, State status, TS_TYPE created_on) :
+        const DeltaMappingsField& mappings, ID_TYPE id, State status, TS_TYPE created_on) :
     BaseT(collection_id, partition_id, mappings, id, status, created_on) {
 }
 
@@ -19,6 +19,9 @@
 #include <map>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <tuple>
+#include <variant>
 #include <condition_variable>
 #include <mutex>
 #include <thread>
@@ -35,11 +38,62 @@ public:
     }
     const MappingT& GetMappings() const { return mappings_; }
     MappingT& GetMappings() { return mappings_; }
+    size_t GetHeapSize() const { return mappings_.size() * sizeof(ID_TYPE); }
 
 protected:
     MappingT mappings_;
 };
 
+// Mappings of a commit that is derived from a parent commit of the same kind. Such a commit is
+// stored as a delta: the parent id and the ids it removed and added. The full mappings are
+// rebuilt from the chain of parents on load, see Store. Every max delta depth commits, or when
+// the delta would not be smaller, the full mappings are stored instead and a new chain starts
+class DeltaMappingsField : public MappingsField {
+public:
+    DeltaMappingsField(const MappingT& mappings = {}) : MappingsField(mappings) {}
+    DeltaMappingsField(ID_TYPE parent_commit_id, ID_TYPE base_commit_id, NUM_TYPE delta_depth,
+            const MappingT& removed, const MappingT& added)
+        : parent_commit_id_(parent_commit_id), base_commit_id_(base_commit_id), delta_depth_(delta_depth),
+          removed_(removed), added_(added) {}
+
+    // Commits this one is stored against: its parent and the full commit that starts the chain.
+    // Both are 0 for a commit stored in full
+    ID_TYPE GetParentCommitId() const { return base_commit_id_ > 0 ? parent_commit_id_ : 0; }
+    ID_TYPE GetBaseCommitId() const { return base_commit_id_; }
+    NUM_TYPE GetDeltaDepth() const { return delta_depth_; }
+    bool IsDelta() const { return base_commit_id_ > 0; }
+    const MappingT& GetRemovedMappings() const { return removed_; }
+    const MappingT& GetAddedMappings() const { return added_; }
+    size_t GetHeapSize() const {
+        return MappingsField::GetHeapSize() + (removed_.size() + added_.size()) * sizeof(ID_TYPE);
+    }
+
+    // Derive this commit from `parent_id`, the commit its fields were copied from
+    void EditMappings(ID_TYPE parent_id, IDS_TYPE removed, IDS_TYPE added);
+
+    // Ids the mappings gained and lost against `parent_id`, whose mappings are `parent_mappings`.
+    // Taken from the delta when this commit was derived from it, otherwise found by a full diff
+    void DiffMappings(ID_TYPE parent_id, const MappingT& parent_mappings,
+            IDS_TYPE& added, IDS_TYPE& removed) const;
+
+    // Rebuild the mappings of a delta decoded from the backend from those of its parent
+    void Materialize(const MappingT& parent_mappings);
+
+    // 0 stores every commit in full
+    static void SetMaxDeltaDepth(NUM_TYPE depth) { max_delta_depth_ = depth; }
+    static NUM_TYPE GetMaxDeltaDepth() { return max_delta_depth_; }
+
+protected:
+    // Also kept for a commit stored in full, while in memory, to speed up the snapshot diff
+    ID_TYPE parent_commit_id_ = 0;
+    ID_TYPE base_commit_id_ = 0;
+    NUM_TYPE delta_depth_ = 0;
+    MappingT removed_;
+    MappingT added_;
+
+    inline static std::atomic<NUM_TYPE> max_delta_depth_ = 16;
+};
+
 class StatusField {
 public:
     StatusField(State status = PENDING) : status_(status) {}
@@ -164,6 +218,7 @@ class NameField {
 public:
     NameField(const std::string& name) : name_(name) {}
     const std::string& GetName() const { return name_; };
+    size_t GetHeapSize() const { return name_.capacity(); }
 
 protected:
     std::string name_;
@@ -267,7 +322,7 @@ using FieldElementPtr = FieldElement::Ptr;
 
 class CollectionCommit : public DBBaseResource<CollectionIdField,
                                                SchemaIdField,
-                                               MappingsField,
+                                               DeltaMappingsField,
                                                IdField,
                                                StatusField,
                                                CreatedOnField>
@@ -277,9 +332,9 @@ public:
     using Ptr = std::shared_ptr<CollectionCommit>;
     using MapT = std::map<ID_TYPE, Ptr>;
     using VecT = std::vector<Ptr>;
-    using BaseT = DBBaseResource<CollectionIdField, SchemaIdField, MappingsField,
+    using BaseT = DBBaseResource<CollectionIdField, SchemaIdField, DeltaMappingsField,
           IdField, StatusField, CreatedOnField>;
-    CollectionCommit(ID_TYPE collection_id, ID_TYPE schema_id, const MappingT& mappings = {}, ID_TYPE id = 0,
+    CollectionCommit(ID_TYPE collection_id, ID_TYPE schema_id, const DeltaMappingsField& mappings = {}, ID_TYPE id = 0,
             State status = PENDING, TS_TYPE created_on = GetMicroSecTimeStamp());
 };
 
@@ -306,7 +361,7 @@ using PartitionPtr = Partition::Ptr;
 
 class PartitionCommit : public DBBaseResource<CollectionIdField,
                                               PartitionIdField,
-                                              MappingsField,
+                                              DeltaMappingsField,
                                               IdField,
                                               StatusField,
                                               CreatedOnField>
@@ -316,10 +371,10 @@ public:
     using MapT = std::map<ID_TYPE, Ptr>;
     using VecT = std::vector<Ptr>;
     static constexpr const char* Name = "PartitionCommit";
-    using BaseT = DBBaseResource<CollectionIdField, PartitionIdField, MappingsField,
+    using BaseT = DBBaseResource<CollectionIdField, PartitionIdField, DeltaMappingsField,
           IdField, StatusField, CreatedOnField>;
     PartitionCommit(ID_TYPE collection_id, ID_TYPE partition_id,
-            const MappingT& mappings = {}, ID_TYPE id = 0, State status = PENDING,
+            const DeltaMappingsField& mappings = {}, ID_TYPE id = 0, State status = PENDING,
             TS_TYPE created_on = GetMicroSecTimeStamp());
 
     std::string ToString() const override;
@@ -393,6 +448,17 @@ public:
 
 using SegmentFilePtr = SegmentFile::Ptr;
 
+template <typename ...ResourceT>
+struct ResourceList {
+    // One map per type, e.g. the resource maps in Store
+    using MapsT = std::tuple<typename ResourceT::MapT...>;
+    // Any one resource, e.g. an operation step
+    using PtrT = std::variant<typename ResourceT::Ptr...>;
+};
+
+using AllResourcesT = ResourceList<CollectionCommit, Collection, SchemaCommit, FieldCommit, Field, FieldElement,
+      PartitionCommit, Partition, SegmentCommit, Segment, SegmentFile>;
+
 } // snapshot
 } // engine
 } // milvus
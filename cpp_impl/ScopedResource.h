@@ -30,7 +30,7 @@ public:
 
     ScopedResource<ResourceT>& operator=(const ScopedResource<ResourceT>& res);
 
-    ResourcePtr Get() { return res_; }
+    ResourcePtr Get() const { return res_; }
 
     ResourceT operator*() const { return *res_; }
     ResourcePtr operator->() const { return res_; }
@@ -35,162 +35,374 @@ Snapshot::DumpSegmentCommits(const std::string& tag) {
     std::cout << typeid(*this).name() << " DumpSegmentCommits   End [" << tag <<  "]" << std::endl;
 }
 
-void Snapshot::RefAll() {
-    collection_commit_->Ref();
-    for (auto& schema : schema_commits_) {
-        schema.second->Ref();
+SnapshotGeneration::~SnapshotGeneration() {
+    for (auto& resource : retired_) {
+        resource->UnRef();
     }
-    for (auto& element : field_elements_) {
-        element.second->Ref();
+    // Unlink the newer generations one by one. Letting next_ go would destroy the whole chain
+    // recursively, one stack frame per version
+    auto next = std::move(next_);
+    while (next && next.use_count() == 1) {
+        auto after = std::move(next->next_);
+        next.reset();
+        next = std::move(after);
     }
-    for (auto& field : fields_) {
-        field.second->Ref();
+}
+
+void
+SnapshotGeneration::Retire(std::vector<ReferenceResourcePtr>&& resources, Ptr next) {
+    assert(!next_);
+    retired_.insert(retired_.end(), resources.begin(), resources.end());
+    next_ = next;
+}
+
+template <typename MapT, typename ScopedT>
+void
+Snapshot::Pin(MapT& map, ID_TYPE id, const ScopedT& resource) {
+    if (map.count(id) > 0) return;
+    map.insert_or_assign(id, resource);
+    pinned_.push_back(resource.Get());
+}
+
+template <typename MapT>
+void
+Snapshot::Unpin(MapT& map, ID_TYPE id) {
+    auto it = map.find(id);
+    if (it == map.end()) return;
+    retired_.push_back(it->second.Get());
+    map.erase(id);
+}
+
+template <typename MapT>
+static void
+CollectPins(const MapT& map, std::vector<ReferenceResourcePtr>& pins) {
+    for (auto& kv : map) {
+        pins.push_back(kv.second.Get());
     }
-    for (auto& field_commit : field_commits_) {
-        field_commit.second->Ref();
+}
+
+std::vector<ReferenceResourcePtr>
+Snapshot::GetPins() const {
+    std::vector<ReferenceResourcePtr> pins = {collection_commit_.Get(), collection_.Get()};
+    CollectPins(schema_commits_, pins);
+    CollectPins(field_elements_, pins);
+    CollectPins(fields_, pins);
+    CollectPins(field_commits_, pins);
+    CollectPins(partitions_, pins);
+    CollectPins(partition_commits_, pins);
+    CollectPins(segments_, pins);
+    CollectPins(segment_commits_, pins);
+    CollectPins(segment_files_, pins);
+    return pins;
+}
+
+void
+Snapshot::Release() {
+    if (!generation_) return;
+    if (!generation_->HasNext()) {
+        // No successor took over this version's pins, e.g. the collection is being closed.
+        // Older versions still in use share them, so they go with this generation
+        generation_->Retire(GetPins(), nullptr);
+    }
+    generation_.reset();
+}
+
+Snapshot::Snapshot(ID_TYPE id) : generation_(std::make_shared<SnapshotGeneration>()) {
+    collection_commit_ = CollectionCommitsHolder::GetInstance().GetResource(id, false);
+    assert(collection_commit_);
+    collection_ = CollectionsHolder::GetInstance().GetResource(collection_commit_->GetCollectionId(), false);
+    pinned_.push_back(collection_commit_.Get());
+    pinned_.push_back(collection_.Get());
+
+    // Level by level: every resource of a level is loaded by one batch
+    auto& mappings = collection_commit_->GetMappings();
+    auto partition_commits = PartitionCommitsHolder::GetInstance().GetResources(
+            IDS_TYPE(mappings.begin(), mappings.end()), false);
+    IDS_TYPE segment_commit_ids;
+    AddPartitionCommits(partition_commits, segment_commit_ids);
+    AddSegmentCommits(segment_commit_ids);
+
+    LoadSchema();
+
+    /* for(auto kv : partition_commits_) { */
+    /*     std::cout << this << " Snapshot " << collection_commit_->GetID() << " PartitionCommit " << */
+    /*         kv.first << " Partition " << kv.second->GetPartitionId() << std::endl; */
+    /* } */
+    /* for(auto kv : p_pc_map_) { */
+    /*     std::cout << this << " Snapshot " << collection_commit_->GetID() << " P " << */
+    /*         kv.first << " PC " << kv.second << std::endl; */
+    /* } */
+
+    for (auto& resource : pinned_) {
+        resource->Ref();
     }
-    collection_->Ref();
-    for (auto& partition : partitions_) {
-        partition.second->Ref();
+    pinned_.clear();
+};
+
+Snapshot::Snapshot(ID_TYPE id, const Snapshot& prev)
+    : collection_(prev.collection_),
+      current_schema_id_(prev.current_schema_id_),
+      schema_commits_(prev.schema_commits_),
+      fields_(prev.fields_),
+      field_commits_(prev.field_commits_),
+      field_elements_(prev.field_elements_),
+      partitions_(prev.partitions_),
+      partition_commits_(prev.partition_commits_),
+      segments_(prev.segments_),
+      segment_commits_(prev.segment_commits_),
+      segment_files_(prev.segment_files_),
+      field_names_map_(prev.field_names_map_),
+      field_element_names_map_(prev.field_element_names_map_),
+      element_segfiles_map_(prev.element_segfiles_map_),
+      seg_segc_map_(prev.seg_segc_map_),
+      p_pc_map_(prev.p_pc_map_),
+      latest_schema_commit_id_(prev.latest_schema_commit_id_),
+      p_max_seg_num_(prev.p_max_seg_num_),
+      generation_(std::make_shared<SnapshotGeneration>()) {
+    collection_commit_ = CollectionCommitsHolder::GetInstance().GetResource(id, false);
+    assert(collection_commit_);
+    assert(collection_commit_->GetCollectionId() == collection_->GetID());
+    pinned_.push_back(collection_commit_.Get());
+    retired_.push_back(prev.collection_commit_.Get());
+
+    IDS_TYPE added;
+    IDS_TYPE removed;
+    collection_commit_->DiffMappings(prev.collection_commit_->GetID(), prev.collection_commit_->GetMappings(),
+            added, removed);
+    std::vector<PartitionCommitScopedT> new_partition_commits;
+    IDS_TYPE segment_commit_ids;
+    IDS_TYPE changed_partition_ids;
+    for (auto& partition_commit : PartitionCommitsHolder::GetInstance().GetResources(added, false)) {
+        auto it = p_pc_map_.find(partition_commit->GetPartitionId());
+        if (it == p_pc_map_.end()) {
+            new_partition_commits.push_back(partition_commit);
+        } else if (ApplyPartitionCommit(partition_commits_[it->second], partition_commit, segment_commit_ids)) {
+            changed_partition_ids.push_back(partition_commit->GetPartitionId());
+        }
     }
-    for (auto& partition_commit : partition_commits_) {
-        partition_commit.second->Ref();
+    AddPartitionCommits(new_partition_commits, segment_commit_ids);
+
+    for (auto pc_id : removed) {
+        // Already replaced by a newer commit of the same partition above
+        if (partition_commits_.find(pc_id) == partition_commits_.end()) continue;
+        RemovePartitionCommit(pc_id);
     }
-    for (auto& segment : segments_) {
-        segment.second->Ref();
+
+    // After every removal: a new commit of the same segment shares segment files with the old one
+    AddSegmentCommits(segment_commit_ids);
+    for (auto partition_id : changed_partition_ids) {
+        UpdateMaxSegmentNum(partition_id);
     }
-    for (auto& segment_commit : segment_commits_) {
-        segment_commit.second->Ref();
+
+    if (collection_commit_->GetSchemaId() != current_schema_id_) {
+        auto field_commits = field_commits_;
+        for (auto& kv : field_commits) {
+            Unpin(field_commits_, kv.first);
+        }
+        auto fields = fields_;
+        for (auto& kv : fields) {
+            Unpin(fields_, kv.first);
+        }
+        field_names_map_.clear();
+        field_element_names_map_.clear();
     }
-    for (auto& segment_file : segment_files_) {
-        segment_file.second->Ref();
+    LoadSchema();
+
+    // Only the delta is pinned here. What this version dropped stays pinned until prev and
+    // every older version are released, see SnapshotGeneration
+    for (auto& resource : pinned_) {
+        resource->Ref();
     }
+    pinned_.clear();
+    prev.generation_->Retire(std::move(retired_), generation_);
+    retired_.clear();
+}
+
+const SnapshotLookup&
+Snapshot::GetLookup() const {
+    std::call_once(lookup_once_, [this]() {
+        lookup_ = std::make_unique<SnapshotLookup>(field_element_names_map_, element_segfiles_map_, seg_segc_map_);
+    });
+    return *lookup_;
 }
 
-void Snapshot::UnRefAll() {
-    /* std::cout << this << " UnRefAll " << collection_commit_->GetID() << " RefCnt=" << RefCnt() << std::endl; */
-    collection_commit_->UnRef();
-    for (auto& schema : schema_commits_) {
-        schema.second->UnRef();
+void
+Snapshot::AddPartitionCommits(const std::vector<PartitionCommitScopedT>& partition_commits,
+        IDS_TYPE& segment_commit_ids) {
+    IDS_TYPE partition_ids;
+    for (auto& partition_commit : partition_commits) {
+        partition_ids.push_back(partition_commit->GetPartitionId());
     }
-    for (auto& element : field_elements_) {
-        element.second->UnRef();
+    auto partitions = PartitionsHolder::GetInstance().GetResources(partition_ids, false);
+    for (size_t i = 0; i < partition_commits.size(); ++i) {
+        auto& partition_commit = partition_commits[i];
+        auto& partition = partitions[i];
+        Pin(partition_commits_, partition_commit->GetID(), partition_commit);
+        p_pc_map_[partition_commit->GetPartitionId()] = partition_commit->GetID();
+        Pin(partitions_, partition_commit->GetPartitionId(), partition);
+        p_max_seg_num_[partition->GetID()] = 0;
+        auto& mappings = partition_commit->GetMappings();
+        segment_commit_ids.insert(segment_commit_ids.end(), mappings.begin(), mappings.end());
     }
-    for (auto& field : fields_) {
-        field.second->UnRef();
+}
+
+bool
+Snapshot::ApplyPartitionCommit(PartitionCommitScopedT prev_partition_commit,
+        PartitionCommitScopedT partition_commit, IDS_TYPE& segment_commit_ids) {
+    IDS_TYPE added;
+    IDS_TYPE removed;
+    partition_commit->DiffMappings(prev_partition_commit->GetID(), prev_partition_commit->GetMappings(),
+            added, removed);
+    for (auto s_c_id : removed) {
+        RemoveSegmentCommit(s_c_id);
     }
-    for (auto& field_commit : field_commits_) {
-        field_commit.second->UnRef();
+    segment_commit_ids.insert(segment_commit_ids.end(), added.begin(), added.end());
+
+    Unpin(partition_commits_, prev_partition_commit->GetID());
+    Pin(partition_commits_, partition_commit->GetID(), partition_commit);
+    p_pc_map_[partition_commit->GetPartitionId()] = partition_commit->GetID();
+    return !removed.empty();
+}
+
+void
+Snapshot::UpdateMaxSegmentNum(ID_TYPE partition_id) {
+    auto& partition_commit = partition_commits_.at(p_pc_map_.at(partition_id));
+    NUM_TYPE max_num = 0;
+    for (auto s_c_id : partition_commit->GetMappings()) {
+        auto& segment = segments_.at(segment_commits_.at(s_c_id)->GetSegmentId());
+        if (segment->GetNum() > max_num) max_num = segment->GetNum();
     }
-    collection_->UnRef();
-    for (auto& partition : partitions_) {
-        partition.second->UnRef();
+    p_max_seg_num_[partition_id] = max_num;
+}
+
+void
+Snapshot::RemovePartitionCommit(ID_TYPE partition_commit_id) {
+    auto it = partition_commits_.find(partition_commit_id);
+    if (it == partition_commits_.end()) return;
+    auto partition_commit = it->second;
+    for (auto s_c_id : partition_commit->GetMappings()) {
+        RemoveSegmentCommit(s_c_id);
     }
-    for (auto& partition_commit : partition_commits_) {
-        partition_commit.second->UnRef();
+    auto partition_id = partition_commit->GetPartitionId();
+    Unpin(partitions_, partition_id);
+    p_pc_map_.erase(partition_id);
+    p_max_seg_num_.erase(partition_id);
+    Unpin(partition_commits_, partition_commit_id);
+}
+
+void
+Snapshot::AddSegmentCommits(const IDS_TYPE& segment_commit_ids) {
+    if (segment_commit_ids.empty()) return;
+    auto segment_commits = SegmentCommitsHolder::GetInstance().GetResources(segment_commit_ids, false);
+    IDS_TYPE segment_ids;
+    IDS_TYPE schema_ids;
+    IDS_TYPE segment_file_ids;
+    for (auto& segment_commit : segment_commits) {
+        segment_ids.push_back(segment_commit->GetSegmentId());
+        schema_ids.push_back(segment_commit->GetSchemaId());
+        auto& mappings = segment_commit->GetMappings();
+        segment_file_ids.insert(segment_file_ids.end(), mappings.begin(), mappings.end());
     }
-    for (auto& segment : segments_) {
-        segment.second->UnRef();
+    auto segments = SegmentsHolder::GetInstance().GetResources(segment_ids, false);
+    auto schemas = SchemaCommitsHolder::GetInstance().GetResources(schema_ids, false);
+    for (size_t i = 0; i < segment_commits.size(); ++i) {
+        auto& segment_commit = segment_commits[i];
+        auto& segment = segments[i];
+        Pin(schema_commits_, schemas[i]->GetID(), schemas[i]);
+        Pin(segment_commits_, segment_commit->GetID(), segment_commit);
+        if (segment->GetNum() > p_max_seg_num_[segment->GetPartitionId()]) {
+            p_max_seg_num_[segment->GetPartitionId()] = segment->GetNum();
+        }
+        Pin(segments_, segment->GetID(), segment);
+        seg_segc_map_.insert_or_assign(segment->GetID(), segment_commit->GetID());
     }
-    for (auto& segment_commit : segment_commits_) {
-        segment_commit.second->UnRef();
+
+    auto segment_files = SegmentFilesHolder::GetInstance().GetResources(segment_file_ids, false);
+    IDS_TYPE field_element_ids;
+    for (auto& segment_file : segment_files) {
+        field_element_ids.push_back(segment_file->GetFieldElementId());
     }
-    for (auto& segment_file : segment_files_) {
-        segment_file.second->UnRef();
+    auto field_elements = FieldElementsHolder::GetInstance().GetResources(field_element_ids, false);
+    for (size_t i = 0; i < segment_files.size(); ++i) {
+        auto& segment_file = segment_files[i];
+        Pin(field_elements_, field_elements[i]->GetID(), field_elements[i]);
+        Pin(segment_files_, segment_file->GetID(), segment_file);
+        element_segfiles_map_[segment_file->GetFieldElementId()].insert_or_assign(
+                segment_file->GetSegmentId(), segment_file->GetID());
     }
 }
 
-Snapshot::Snapshot(ID_TYPE id) {
-    collection_commit_ = CollectionCommitsHolder::GetInstance().GetResource(id, false);
-    assert(collection_commit_);
+void
+Snapshot::RemoveSegmentCommit(ID_TYPE segment_commit_id) {
+    // Persistent map iterators are invalidated by updates, so erase by key below
+    auto it = segment_commits_.find(segment_commit_id);
+    if (it == segment_commits_.end()) return;
+    auto segment_commit = it->second;
+    auto segment_id = segment_commit->GetSegmentId();
+    for (auto s_f_id : segment_commit->GetMappings()) {
+        auto itf = segment_files_.find(s_f_id);
+        if (itf == segment_files_.end()) continue;
+        auto entry = element_segfiles_map_.find(itf->second->GetFieldElementId());
+        if (entry != element_segfiles_map_.end()) {
+            entry->second.erase(segment_id);
+            if (entry->second.size() == 0) element_segfiles_map_.erase(entry);
+        }
+        Unpin(segment_files_, s_f_id);
+    }
+
+    auto its = seg_segc_map_.find(segment_id);
+    if (its != seg_segc_map_.end() && its->second == segment_commit_id) {
+        seg_segc_map_.erase(segment_id);
+        Unpin(segments_, segment_id);
+    }
+    Unpin(segment_commits_, segment_commit_id);
+}
+
+void
+Snapshot::LoadSchema() {
     auto& schema_holder =  SchemaCommitsHolder::GetInstance();
-    auto current_schema = schema_holder.GetResource(collection_commit_->GetSchemaId(), false);
-    schema_commits_[current_schema->GetID()] = current_schema;
-    current_schema_id_ = current_schema->GetID();
     auto& field_commits_holder = FieldCommitsHolder::GetInstance();
     auto& fields_holder = FieldsHolder::GetInstance();
     auto& field_elements_holder = FieldElementsHolder::GetInstance();
 
-    collection_ = CollectionsHolder::GetInstance().GetResource(collection_commit_->GetCollectionId(), false);
-    auto& mappings =  collection_commit_->GetMappings();
-    auto& partition_commits_holder = PartitionCommitsHolder::GetInstance();
-    auto& partitions_holder = PartitionsHolder::GetInstance();
-    auto& segments_holder = SegmentsHolder::GetInstance();
-    auto& segment_commits_holder = SegmentCommitsHolder::GetInstance();
-    auto& segment_files_holder = SegmentFilesHolder::GetInstance();
-
-    for (auto& id : mappings) {
-        auto partition_commit = partition_commits_holder.GetResource(id, false);
-        auto partition = partitions_holder.GetResource(partition_commit->GetPartitionId(), false);
-        partition_commits_[partition_commit->GetID()] = partition_commit;
-        p_pc_map_[partition_commit->GetPartitionId()] = partition_commit->GetID();
-        partitions_[partition_commit->GetPartitionId()] = partition;
-        p_max_seg_num_[partition->GetID()] = 0;
-        auto& s_c_mappings = partition_commit->GetMappings();
-        for (auto& s_c_id : s_c_mappings) {
-            auto segment_commit = segment_commits_holder.GetResource(s_c_id, false);
-            auto segment = segments_holder.GetResource(segment_commit->GetSegmentId(), false);
-            auto schema = schema_holder.GetResource(segment_commit->GetSchemaId(), false);
-            schema_commits_[schema->GetID()] = schema;
-            segment_commits_[segment_commit->GetID()] = segment_commit;
-            if (segment->GetNum() > p_max_seg_num_[segment->GetPartitionId()]) {
-                p_max_seg_num_[segment->GetPartitionId()] = segment->GetNum();
-            }
-            segments_[segment->GetID()] = segment;
-            seg_segc_map_[segment->GetID()] = segment_commit->GetID();
-            auto& s_f_mappings = segment_commit->GetMappings();
-            for (auto& s_f_id : s_f_mappings) {
-                auto segment_file = segment_files_holder.GetResource(s_f_id, false);
-                auto field_element = field_elements_holder.GetResource(segment_file->GetFieldElementId(), false);
-                field_elements_[field_element->GetID()] = field_element;
-                segment_files_[s_f_id] = segment_file;
-                auto entry = element_segfiles_map_.find(segment_file->GetFieldElementId());
-                if (entry == element_segfiles_map_.end()) {
-                    element_segfiles_map_[segment_file->GetFieldElementId()] = {
-                        {segment_file->GetSegmentId(), segment_file->GetID()}
-                    };
-                } else {
-                    entry->second[segment_file->GetSegmentId()] = segment_file->GetID();
-                }
-            }
-        }
-    }
+    auto current_schema = schema_holder.GetResource(collection_commit_->GetSchemaId(), false);
+    Pin(schema_commits_, current_schema->GetID(), current_schema);
+    current_schema_id_ = current_schema->GetID();
 
     for (auto& kv : schema_commits_) {
         if (kv.first > latest_schema_commit_id_) latest_schema_commit_id_ = kv.first;
-        auto& schema_commit = kv.second;
-        auto& s_c_m =  current_schema->GetMappings();
-        for (auto field_commit_id : s_c_m) {
-            auto field_commit = field_commits_holder.GetResource(field_commit_id, false);
-            field_commits_[field_commit_id] = field_commit;
-            auto field = fields_holder.GetResource(field_commit->GetFieldId(), false);
-            fields_[field->GetID()] = field;
-            field_names_map_[field->GetName()] = field->GetID();
-            auto& f_c_m = field_commit->GetMappings();
-            for (auto field_element_id : f_c_m) {
-                auto field_element = field_elements_holder.GetResource(field_element_id, false);
-                field_elements_[field_element_id] = field_element;
-                auto entry = field_element_names_map_.find(field->GetName());
-                if (entry == field_element_names_map_.end()) {
-                    field_element_names_map_[field->GetName()] = {{field_element->GetName(), field_element->GetID()}};
-                } else {
-                    entry->second[field_element->GetName()] = field_element->GetID();
-                }
-            }
-        }
     }
 
-    /* for(auto kv : partition_commits_) { */
-    /*     std::cout << this << " Snapshot " << collection_commit_->GetID() << " PartitionCommit " << */
-    /*         kv.first << " Partition " << kv.second->GetPartitionId() << std::endl; */
-    /* } */
-    /* for(auto kv : p_pc_map_) { */
-    /*     std::cout << this << " Snapshot " << collection_commit_->GetID() << " P " << */
-    /*         kv.first << " PC " << kv.second << std::endl; */
-    /* } */
+    // Field maps are kept from the previous snapshot while the schema is unchanged
+    if (field_commits_.size() > 0) return;
 
-    RefAll();
-};
+    auto& s_c_m =  current_schema->GetMappings();
+    auto field_commits = field_commits_holder.GetResources(IDS_TYPE(s_c_m.begin(), s_c_m.end()), false);
+    IDS_TYPE field_ids;
+    IDS_TYPE field_element_ids;
+    for (auto& field_commit : field_commits) {
+        field_ids.push_back(field_commit->GetFieldId());
+        auto& f_c_m = field_commit->GetMappings();
+        field_element_ids.insert(field_element_ids.end(), f_c_m.begin(), f_c_m.end());
+    }
+    auto fields = fields_holder.GetResources(field_ids, false);
+    auto field_elements = field_elements_holder.GetResources(field_element_ids, false);
+
+    size_t element_pos = 0;
+    for (size_t i = 0; i < field_commits.size(); ++i) {
+        auto& field_commit = field_commits[i];
+        auto& field = fields[i];
+        Pin(field_commits_, field_commit->GetID(), field_commit);
+        Pin(fields_, field->GetID(), field);
+        field_names_map_[field->GetName()] = field->GetID();
+        auto& element_names = field_element_names_map_[field->GetName()];
+        for (size_t n = 0; n < field_commit->GetMappings().size(); ++n) {
+            auto& field_element = field_elements[element_pos++];
+            Pin(field_elements_, field_element->GetID(), field_element);
+            element_names[field_element->GetName()] = field_element->GetID();
+        }
+    }
+}
 
 } // snapshot
 } // engine
@@ -11,6 +11,7 @@
 
 #pragma once
 #include "WrappedTypes.h"
+#include "SnapshotLookup.h"
 #include <memory>
 #include <string>
 #include <vector>
@@ -28,11 +29,31 @@ namespace milvus {
 namespace engine {
 namespace snapshot {
 
+// Pins handed over from one snapshot version to the next. A derived snapshot only Refs what it
+// added and retires what it dropped into its predecessor's generation. The retired resources
+// are UnRef'ed when that generation dies, i.e. once the predecessor and every older version of
+// the collection are released, since each generation is kept alive by the one before it.
+// The latest version has nobody to hand over to: on release its pins go to its own generation.
+class SnapshotGeneration {
+public:
+    using Ptr = std::shared_ptr<SnapshotGeneration>;
+    ~SnapshotGeneration();
+
+    void Retire(std::vector<ReferenceResourcePtr>&& resources, Ptr next);
+    bool HasNext() const { return next_ != nullptr; }
+
+private:
+    std::vector<ReferenceResourcePtr> retired_;
+    Ptr next_;
+};
 
 class Snapshot : public ReferenceProxy {
 public:
     using Ptr = std::shared_ptr<Snapshot>;
     Snapshot(ID_TYPE id);
+    // Derive snapshot `id` from `prev` of the same collection. Only partition commits and
+    // segment commits that differ between the two collection commits are loaded
+    Snapshot(ID_TYPE id, const Snapshot& prev);
 
     ID_TYPE GetID() const { return collection_commit_->GetID();}
     ID_TYPE GetCollectionId() const { return collection_->GetID(); }
@@ -59,8 +80,7 @@ public:
         return it->second.Get();
     }
 
-    // PXU TODO: add const. Need to change Scopedxxxx::Get
-    SegmentCommitPtr GetSegmentCommit(ID_TYPE segment_id) {
+    SegmentCommitPtr GetSegmentCommit(ID_TYPE segment_id) const {
         auto it = seg_segc_map_.find(segment_id);
         if (it == seg_segc_map_.end()) return nullptr;
         auto itsc = segment_commits_.find(it->second);
@@ -90,15 +110,14 @@ public:
 
     std::vector<std::string> GetFieldNames() const {
         std::vector<std::string> names;
-        for(auto& kv : field_names_map_) {
-            names.emplace_back(kv.first);
+        for (auto& kv : field_names_map_) {
+            names.push_back(kv.first);
         }
-        return std::move(names);
+        return names;
     }
 
     bool HasField(const std::string& name) const {
-        auto it = field_names_map_.find(name);
-        return it != field_names_map_.end();
+        return field_names_map_.find(name) != field_names_map_.end();
     }
 
     bool HasFieldElement(const std::string& field_name, const std::string& field_element_name) const {
@@ -108,16 +127,7 @@ public:
 
     ID_TYPE GetSegmentFileId(const std::string& field_name, const std::string& field_element_name,
             ID_TYPE segment_id) const {
-        auto field_element_id = GetFieldElementId(field_name, field_element_name);
-        auto it = element_segfiles_map_.find(field_element_id);
-        if (it == element_segfiles_map_.end()) {
-            return 0;
-        }
-        auto its = it->second.find(segment_id);
-        if (its == it->second.end()) {
-            return 0;
-        }
-        return its->second;
+        return GetLookup().GetSegmentFileId(field_name, field_element_name, segment_id);
     }
 
     bool HasSegmentFile(const std::string& field_name, const std::string& field_element_name,
@@ -128,12 +138,9 @@ public:
 
     ID_TYPE GetFieldElementId(const std::string& field_name, const std::string& field_element_name) const {
         auto itf = field_element_names_map_.find(field_name);
-        if (itf == field_element_names_map_.end()) return false;
+        if (itf == field_element_names_map_.end()) return 0;
         auto itfe = itf->second.find(field_element_name);
-        if (itfe == itf->second.end()) {
-            return 0;
-        }
-
+        if (itfe == itf->second.end()) return 0;
         return itfe->second;
     }
 
@@ -146,6 +153,16 @@ public:
         return std::move(names);
     }
 
+    std::vector<std::string> GetFieldElementNames(const std::string& field_name) const {
+        std::vector<std::string> names;
+        auto it = field_element_names_map_.find(field_name);
+        if (it == field_element_names_map_.end()) return names;
+        for (auto& kv : it->second) {
+            names.push_back(kv.first);
+        }
+        return names;
+    }
+
     IDS_TYPE GetSegmentIds() const {
         IDS_TYPE ids;
         for(auto& kv : segments_) {
@@ -168,14 +185,34 @@ public:
         return it->second;
     }
 
-    void RefAll();
-    void UnRefAll();
+    // Let go of this version's generation. Called when the last reference to the snapshot goes away
+    void Release();
 
     void DumpSegments(const std::string& tag = "");
     void DumpSegmentCommits(const std::string& tag = "");
     void DumpPartitionCommits(const std::string& tag = "");
 
 private:
+    // The Add and Apply steps only collect the segment commits they reference. Those are loaded
+    // together by AddSegmentCommits afterwards, once all removals are done
+    void AddPartitionCommits(const std::vector<PartitionCommitScopedT>& partition_commits,
+            IDS_TYPE& segment_commit_ids);
+    // Returns whether any segment commit was removed
+    bool ApplyPartitionCommit(PartitionCommitScopedT prev_partition_commit,
+            PartitionCommitScopedT partition_commit, IDS_TYPE& segment_commit_ids);
+    void UpdateMaxSegmentNum(ID_TYPE partition_id);
+    void RemovePartitionCommit(ID_TYPE partition_commit_id);
+    void AddSegmentCommits(const IDS_TYPE& segment_commit_ids);
+    void RemoveSegmentCommit(ID_TYPE segment_commit_id);
+    void LoadSchema();
+    std::vector<ReferenceResourcePtr> GetPins() const;
+    const SnapshotLookup& GetLookup() const;
+
+    template <typename MapT, typename ScopedT>
+    void Pin(MapT& map, ID_TYPE id, const ScopedT& resource);
+    template <typename MapT>
+    void Unpin(MapT& map, ID_TYPE id);
+
     // PXU TODO: Re-org below data structures to reduce memory usage
     CollectionScopedT collection_;
     ID_TYPE current_schema_id_;
@@ -191,11 +228,22 @@ private:
     SegmentFilesT segment_files_;
     std::map<std::string, ID_TYPE> field_names_map_;
     std::map<std::string, std::map<std::string, ID_TYPE>> field_element_names_map_;
-    std::map<ID_TYPE, std::map<ID_TYPE, ID_TYPE>> element_segfiles_map_;
-    std::map<ID_TYPE, ID_TYPE> seg_segc_map_;
+    std::map<ID_TYPE, IdMapT> element_segfiles_map_;
+    IdMapT seg_segc_map_;
     std::map<ID_TYPE, ID_TYPE> p_pc_map_;
-    ID_TYPE latest_schema_commit_id_;
+    ID_TYPE latest_schema_commit_id_ = 0;
     std::map<ID_TYPE, NUM_TYPE> p_max_seg_num_;
+
+    // Point lookups, which every write does on the latest version, go to the maps above. Only the
+    // segment file table is flattened, on first use, so that publishing a version stays
+    // proportional to its delta and only versions that are actually searched pay for the build
+    mutable std::once_flag lookup_once_;
+    mutable std::unique_ptr<SnapshotLookup> lookup_;
+
+    SnapshotGeneration::Ptr generation_;
+    // Only used while constructing: resources this version newly references and drops
+    std::vector<ReferenceResourcePtr> pinned_;
+    std::vector<ReferenceResourcePtr> retired_;
 };
 
 using ScopedSnapshotT = ScopedResource<Snapshot>;
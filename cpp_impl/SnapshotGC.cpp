@@ -0,0 +1,130 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include "SnapshotGC.h"
+#include <iostream>
+#include <limits>
+#include <algorithm>
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+SnapshotGC::SnapshotGC() {
+    // Submitters are writers publishing a new version: never block them
+    queue_.SetCapacity(std::numeric_limits<size_t>::max());
+}
+
+SnapshotGC::~SnapshotGC() {
+    Stop();
+}
+
+SnapshotGC&
+SnapshotGC::GetInstance() {
+    static SnapshotGC gc;
+    return gc;
+}
+
+void
+SnapshotGC::Submit(Snapshot::Ptr ss) {
+    if (!ss) return;
+    Task task = {ss, std::chrono::steady_clock::now()};
+    size_t submitted = ++submitted_;
+    size_t reclaimed = reclaimed_;
+    size_t backlog = submitted > reclaimed ? submitted - reclaimed : 0;
+    auto max_backlog = max_backlog_.load();
+    while (backlog > max_backlog && !max_backlog_.compare_exchange_weak(max_backlog, backlog)) {}
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (running_) {
+            queue_.Put(task);
+            return;
+        }
+    }
+    Reclaim(task);
+}
+
+void
+SnapshotGC::Reclaim(const Task& task) {
+    task.ss->UnRef();
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - task.submitted_on).count();
+    total_latency_us_ += latency;
+    auto max_latency = max_latency_us_.load();
+    while (latency > max_latency && !max_latency_us_.compare_exchange_weak(max_latency, latency)) {}
+    ++reclaimed_;
+}
+
+SnapshotGCStats
+SnapshotGC::GetStats() const {
+    SnapshotGCStats stats;
+    stats.reclaimed = reclaimed_;
+    stats.submitted = submitted_;
+    stats.backlog = stats.submitted > stats.reclaimed ? stats.submitted - stats.reclaimed : 0;
+    stats.max_backlog = max_backlog_;
+    stats.total_latency = std::chrono::microseconds(total_latency_us_.load());
+    stats.max_latency = std::chrono::microseconds(max_latency_us_.load());
+    return stats;
+}
+
+void
+SnapshotGC::Start(const SnapshotGCOptions& options) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (running_ || stopped_) return;
+    for (size_t i = 0; i < std::max<size_t>(options.worker_num, 1); ++i) {
+        threads_.push_back(std::make_shared<std::thread>(&SnapshotGC::ThreadMain, this));
+    }
+    running_ = true;
+    std::cout << "SnapshotGC Started with " << threads_.size() << " workers" << std::endl;
+}
+
+void
+SnapshotGC::Stop() {
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (!running_) return;
+        for (size_t i = 0; i < threads_.size(); ++i) {
+            queue_.Put(Task());
+        }
+    }
+    for (auto& thread : threads_) {
+        thread->join();
+    }
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        running_ = false;
+        stopped_ = true;
+    }
+    // Submitted behind the stop markers
+    while (!queue_.Empty()) {
+        auto task = queue_.Take();
+        if (task.ss) Reclaim(task);
+    }
+    auto stats = GetStats();
+    std::cout << "SnapshotGC Stopped: " << stats.reclaimed << " snapshots reclaimed, max backlog "
+              << stats.max_backlog << ", max latency " << stats.max_latency.count() << "us" << std::endl;
+}
+
+void
+SnapshotGC::ThreadMain() {
+    while (true) {
+        auto task = queue_.Take();
+        if (!task.ss) {
+            std::cout << "Stopping snapshot gc thread " << std::this_thread::get_id() << std::endl;
+            break;
+        }
+        Reclaim(task);
+    }
+}
+
+} // snapshot
+} // engine
+} // milvus
@@ -0,0 +1,87 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+#include "Snapshot.h"
+#include "utils/BlockingQueue.h"
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+struct SnapshotGCOptions {
+    size_t worker_num = 2;
+};
+
+struct SnapshotGCStats {
+    size_t submitted = 0;
+    size_t reclaimed = 0;
+    // Retired snapshots waiting for a worker
+    size_t backlog = 0;
+    size_t max_backlog = 0;
+    // From submit to the snapshot's pins being dropped
+    std::chrono::microseconds total_latency = std::chrono::microseconds(0);
+    std::chrono::microseconds max_latency = std::chrono::microseconds(0);
+};
+
+// Drops the pins of snapshots retired by any holder, on a small pool of workers shared by all
+// collections. Workers block on the queue and wake on each submit. Until started, and once
+// stopped, a retired snapshot is released in the thread that submits it
+class SnapshotGC {
+public:
+    SnapshotGC(const SnapshotGC&) = delete;
+
+    static SnapshotGC& GetInstance();
+
+    void Submit(Snapshot::Ptr ss);
+
+    void Start(const SnapshotGCOptions& options = SnapshotGCOptions());
+
+    void Stop();
+
+    SnapshotGCStats GetStats() const;
+
+    ~SnapshotGC();
+
+protected:
+    struct Task {
+        Snapshot::Ptr ss;
+        std::chrono::steady_clock::time_point submitted_on;
+    };
+    using TaskQueueT = server::BlockingQueue<Task>;
+
+    SnapshotGC();
+
+    void ThreadMain();
+    void Reclaim(const Task& task);
+
+    mutable std::mutex mtx_;
+    bool running_ = false;
+    bool stopped_ = false;
+    std::vector<std::shared_ptr<std::thread>> threads_;
+    TaskQueueT queue_;
+
+    std::atomic<size_t> submitted_ = 0;
+    std::atomic<size_t> reclaimed_ = 0;
+    std::atomic<size_t> max_backlog_ = 0;
+    std::atomic<int64_t> total_latency_us_ = 0;
+    std::atomic<int64_t> max_latency_us_ = 0;
+};
+
+} // snapshot
+} // engine
+} // milvus
@@ -24,15 +24,37 @@ SnapshotHolder::SnapshotHolder(ID_TYPE collection_id, GCHandler gc_handler, size
       done_(false) {
 }
 
+ScopedSnapshotT
+SnapshotHolder::GetLatestSnapshot(bool scoped) {
+    while (true) {
+        auto ss = std::atomic_load(&latest_);
+        if (!ss || !scoped) return ScopedSnapshotT(ss, false);
+        // Fails only if ss was retired and released after it was loaded, in which case latest_
+        // has moved on. No writer ever waits for readers here
+        if (ss->TryRef()) {
+            ScopedSnapshotT ret(ss);
+            ss->UnRef();
+            return ret;
+        }
+        if (std::atomic_load(&latest_) == ss) return ScopedSnapshotT();
+    }
+}
+
 ScopedSnapshotT
 SnapshotHolder::GetSnapshot(ID_TYPE id, bool scoped) {
+    if (id == 0) {
+        return GetLatestSnapshot(scoped);
+    }
+    {
+        auto latest = GetLatestSnapshot(scoped);
+        if (latest && latest->GetID() == id) {
+            return latest;
+        }
+    }
+
     std::unique_lock<std::mutex> lock(mutex_);
     /* std::cout << "Holder " << collection_id_ << " actives num=" << active_.size() */
     /*     << " latest=" << active_[max_id_]->GetID() << " RefCnt=" << active_[max_id_]->RefCnt() <<  std::endl; */
-    if (id == 0 || id == max_id_) {
-        auto ss = active_[max_id_];
-        return ScopedSnapshotT(ss, scoped);
-    }
     if (id < min_id_) {
         return ScopedSnapshotT();
     }
@@ -62,16 +84,24 @@ SnapshotHolder::AddNoLock(ID_TYPE id) {
     }
     Snapshot::Ptr oldest_ss;
     {
-        auto ss = std::make_shared<Snapshot>(id);
-
         if (done_) { return false; };
-        ss->RegisterOnNoRefCB(std::bind(&Snapshot::UnRefAll, ss));
-        ss->Ref();
         auto it = active_.find(id);
         if (it != active_.end()) {
             return false;
         }
 
+        // A derived snapshot hands its pins over from its predecessor, so it must be published
+        // once built: every check that could reject it happens above
+        Snapshot::Ptr ss;
+        if (active_.size() > 0) {
+            // Derive from the latest version so publish cost follows the commit delta
+            ss = std::make_shared<Snapshot>(id, *active_.rbegin()->second);
+        } else {
+            ss = std::make_shared<Snapshot>(id);
+        }
+        ss->RegisterOnNoRefCB(std::bind(&Snapshot::Release, ss));
+        ss->Ref();
+
         if (min_id_ > id) {
             min_id_ = id;
         }
@@ -81,6 +111,7 @@ SnapshotHolder::AddNoLock(ID_TYPE id) {
         }
 
         active_[id] = ss;
+        std::atomic_store(&latest_, active_[max_id_]);
         if (active_.size() <= num_versions_)
             return true;
 
@@ -95,34 +126,7 @@ SnapshotHolder::AddNoLock(ID_TYPE id) {
 
 void
 SnapshotHolder::NotifyDone() {
-    std::unique_lock<std::mutex> lock(gcmutex_);
     done_ = true;
-    cv_.notify_all();
-}
-
-void
-SnapshotHolder::BackgroundGC() {
-    while (true) {
-        if (done_.load(std::memory_order_acquire)) {
-            break;
-        }
-        std::vector<Snapshot::Ptr> sss;
-        {
-            std::unique_lock<std::mutex> lock(gcmutex_);
-            cv_.wait_for(lock, std::chrono::milliseconds(100), [this]() {return to_release_.size() > 0;});
-            if (to_release_.size() > 0) {
-                /* std::cout << "size = " << to_release_.size() << std::endl; */
-                sss = to_release_;
-                to_release_.clear();
-            }
-        }
-
-        for (auto& ss : sss) {
-            ss->UnRef();
-            /* std::cout << "BG Handling " << ss->GetID() << " RefCnt=" << ss->RefCnt() << std::endl; */
-        }
-
-    }
 }
 
 void
@@ -25,19 +25,11 @@ public:
     ID_TYPE GetID() const { return collection_id_; }
     bool Add(ID_TYPE id);
 
-    void BackgroundGC();
-
     void NotifyDone();
 
+    // Latest snapshot is served lock-free. Older versions fall back to mutex_
     ScopedSnapshotT GetSnapshot(ID_TYPE id = 0, bool scoped = true);
 
-    void GCHandlerTestCallBack(Snapshot::Ptr ss) {
-        std::unique_lock<std::mutex> lock(gcmutex_);
-        to_release_.push_back(ss);
-        lock.unlock();
-        cv_.notify_one();
-    }
-
     bool SetGCHandler(GCHandler gc_handler) {
         gc_handler_ = gc_handler;
     }
@@ -46,6 +38,8 @@ private:
     void LoadNoLock(ID_TYPE collection_commit_id);
     bool AddNoLock(ID_TYPE id);
 
+    ScopedSnapshotT GetLatestSnapshot(bool scoped);
+
     void ReadyForRelease(Snapshot::Ptr ss) {
         if (gc_handler_) {
             gc_handler_(ss);
@@ -53,13 +47,12 @@ private:
     }
 
     std::mutex mutex_;
-    std::mutex gcmutex_;
-    std::condition_variable cv_;
     ID_TYPE collection_id_;
     ID_TYPE min_id_ = std::numeric_limits<ID_TYPE>::max();
     ID_TYPE max_id_ = std::numeric_limits<ID_TYPE>::min();
     std::map<ID_TYPE, Snapshot::Ptr> active_;
-    std::vector<Snapshot::Ptr> to_release_;
+    // active_[max_id_], published with std::atomic_store and read with std::atomic_load
+    Snapshot::Ptr latest_;
     size_t num_versions_ = 1;
     GCHandler gc_handler_;
     std::atomic<bool> done_;
@@ -0,0 +1,83 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include "SnapshotLookup.h"
+#include <algorithm>
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+SnapshotLookup::SnapshotLookup(const FieldElementNamesT& field_element_names,
+        const ElementSegmentFilesT& element_segment_files, const IdMapT& segment_commits) {
+    // Maps iterate in key order, so every vector below comes out sorted
+    std::map<ID_TYPE, size_t> slots;
+    for (auto& kv : element_segment_files) {
+        slots.emplace(kv.first, slots.size());
+    }
+    slot_num_ = slots.size();
+    for (auto& field : field_element_names) {
+        for (auto& element : field.second) {
+            auto it = slots.find(element.second);
+            field_elements_.push_back({field.first, element.first, it == slots.end() ? NO_SLOT : it->second});
+        }
+    }
+
+    segment_ids_.reserve(segment_commits.size());
+    for (auto& kv : segment_commits) {
+        segment_ids_.push_back(kv.first);
+    }
+
+    segment_files_.assign(segment_ids_.size() * slot_num_, 0);
+    for (auto& kv : element_segment_files) {
+        auto slot = slots[kv.first];
+        for (auto& segment_file : kv.second) {
+            auto row = FindSegment(segment_file.first);
+            if (row == NO_SLOT) continue;
+            segment_files_[row * slot_num_ + slot] = segment_file.second;
+        }
+    }
+}
+
+const SnapshotLookup::FieldElementEntry*
+SnapshotLookup::FindFieldElement(const std::string& field_name, const std::string& field_element_name) const {
+    auto it = std::lower_bound(field_elements_.begin(), field_elements_.end(),
+            std::make_pair(&field_name, &field_element_name),
+            [](const FieldElementEntry& entry, const std::pair<const std::string*, const std::string*>& key) {
+                auto c = entry.field_name.compare(*key.first);
+                return c < 0 || (c == 0 && entry.field_element_name < *key.second);
+            });
+    if (it == field_elements_.end() || it->field_name != field_name || it->field_element_name != field_element_name) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+size_t
+SnapshotLookup::FindSegment(ID_TYPE segment_id) const {
+    auto it = std::lower_bound(segment_ids_.begin(), segment_ids_.end(), segment_id);
+    if (it == segment_ids_.end() || *it != segment_id) return NO_SLOT;
+    return it - segment_ids_.begin();
+}
+
+ID_TYPE
+SnapshotLookup::GetSegmentFileId(const std::string& field_name, const std::string& field_element_name,
+        ID_TYPE segment_id) const {
+    auto entry = FindFieldElement(field_name, field_element_name);
+    if (!entry || entry->slot == NO_SLOT) return 0;
+    auto row = FindSegment(segment_id);
+    if (row == NO_SLOT) return 0;
+    return segment_files_[row * slot_num_ + entry->slot];
+}
+
+} // snapshot
+} // engine
+} // milvus
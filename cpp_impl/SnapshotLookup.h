@@ -0,0 +1,65 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+#include "WrappedTypes.h"
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+// Read-only segment file table of one snapshot version, flattened from its maps. Field elements
+// and segments are kept in sorted vectors and numbered by their position in them. Segment files
+// are then one dense table indexed by segment and element number, so a segment file lookup is
+// two binary searches over contiguous memory and no tree walk
+class SnapshotLookup {
+public:
+    using FieldElementNamesT = std::map<std::string, std::map<std::string, ID_TYPE>>;
+    using ElementSegmentFilesT = std::map<ID_TYPE, IdMapT>;
+
+    // `segment_commits` maps the segments of the version to their commits
+    SnapshotLookup(const FieldElementNamesT& field_element_names,
+            const ElementSegmentFilesT& element_segment_files, const IdMapT& segment_commits);
+
+    // 0 if not found
+    ID_TYPE GetSegmentFileId(const std::string& field_name, const std::string& field_element_name,
+            ID_TYPE segment_id) const;
+
+private:
+    static constexpr size_t NO_SLOT = static_cast<size_t>(-1);
+
+    struct FieldElementEntry {
+        std::string field_name;
+        std::string field_element_name;
+        // Column in segment_files_, NO_SLOT if the element has no segment files
+        size_t slot;
+    };
+
+    const FieldElementEntry* FindFieldElement(const std::string& field_name,
+            const std::string& field_element_name) const;
+    size_t FindSegment(ID_TYPE segment_id) const;
+
+    // Sorted by field name, then element name
+    std::vector<FieldElementEntry> field_elements_;
+    size_t slot_num_ = 0;
+    // Sorted. A segment's position is its row in segment_files_
+    IDS_TYPE segment_ids_;
+    // Row major, segment_ids_.size() x slot_num_, 0 where a segment has no file of an element
+    IDS_TYPE segment_files_;
+};
+
+} // snapshot
+} // engine
+} // milvus
@@ -63,12 +63,50 @@ Snapshots::Close(ID_TYPE collection_id) {
 
 SnapshotHolderPtr
 Snapshots::Load(ID_TYPE collection_id) {
-    std::unique_lock<std::shared_timed_mutex> lock(mutex_);
-    return LoadNoLock(collection_id);
+    std::promise<SnapshotHolderPtr> promise;
+    std::shared_future<SnapshotHolderPtr> future;
+    {
+        std::unique_lock<std::shared_timed_mutex> lock(mutex_);
+        auto holder = GetHolderNoLock(collection_id);
+        if (holder) return holder;
+        auto it = loading_.find(collection_id);
+        if (it != loading_.end()) {
+            future = it->second;
+        } else {
+            loading_[collection_id] = promise.get_future().share();
+        }
+    }
+
+    if (future.valid()) {
+        return future.get();
+    }
+
+    SnapshotHolderPtr holder;
+    try {
+        holder = DoLoad(collection_id);
+    } catch (...) {
+        // Hand the failure to the waiters and let the next caller retry
+        {
+            std::unique_lock<std::shared_timed_mutex> lock(mutex_);
+            loading_.erase(collection_id);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+    {
+        std::unique_lock<std::shared_timed_mutex> lock(mutex_);
+        if (holder) {
+            holders_[collection_id] = holder;
+            name_id_map_[holder->GetSnapshot()->GetName()] = collection_id;
+        }
+        loading_.erase(collection_id);
+    }
+    promise.set_value(holder);
+    return holder;
 }
 
 SnapshotHolderPtr
-Snapshots::LoadNoLock(ID_TYPE collection_id) {
+Snapshots::DoLoad(ID_TYPE collection_id) {
     auto op = std::make_shared<GetSnapshotIDsOperation>(collection_id, false);
     op->Push();
     auto& collection_commit_ids = op->GetIDs();
@@ -80,8 +118,6 @@ Snapshots::LoadNoLock(ID_TYPE collection_id) {
     for (auto c_c_id : collection_commit_ids) {
         holder->Add(c_c_id);
     }
-    holders_[collection_id] = holder;
-    name_id_map_[holder->GetSnapshot()->GetName()] = collection_id;
     return holder;
 }
 
@@ -98,10 +134,11 @@ Snapshots::Init() {
 SnapshotHolderPtr
 Snapshots::GetHolder(const std::string& name) {
     {
-        std::unique_lock<std::shared_timed_mutex> lock(mutex_);
+        std::shared_lock<std::shared_timed_mutex> lock(mutex_);
         auto kv = name_id_map_.find(name);
         if (kv != name_id_map_.end()) {
-            return GetHolderNoLock(kv->second);
+            auto holder = GetHolderNoLock(kv->second);
+            if (holder) return holder;
         }
     }
     LoadOperationContext context;
@@ -115,24 +152,27 @@ Snapshots::GetHolder(const std::string& name) {
 
 SnapshotHolderPtr
 Snapshots::GetHolder(ID_TYPE collection_id) {
-    std::unique_lock<std::shared_timed_mutex> lock(mutex_);
-    return GetHolderNoLock(collection_id);
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(mutex_);
+        auto holder = GetHolderNoLock(collection_id);
+        if (holder) return holder;
+    }
+    return Load(collection_id);
 }
 
 SnapshotHolderPtr
-Snapshots::GetHolderNoLock(ID_TYPE collection_id) {
+Snapshots::GetHolderNoLock(ID_TYPE collection_id) const {
     auto it = holders_.find(collection_id);
     if (it == holders_.end()) {
-        return LoadNoLock(collection_id);
+        return nullptr;
     }
     return it->second;
 }
 
 void
 Snapshots::SnapshotGCCallback(Snapshot::Ptr ss_ptr) {
-    /* to_release_.push_back(ss_ptr); */
-    ss_ptr->UnRef();
-    std::cout << &(*ss_ptr) << " Snapshot " << ss_ptr->GetID() << " RefCnt = " << ss_ptr->RefCnt() << " To be removed" << std::endl;
+    std::cout << &(*ss_ptr) << " Snapshot " << ss_ptr->GetID() << " To be removed" << std::endl;
+    SnapshotGC::GetInstance().Submit(ss_ptr);
 }
 
 } // snapshot
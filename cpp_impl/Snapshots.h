@@ -11,6 +11,7 @@
 
 #pragma once
 #include "SnapshotHolder.h"
+#include "SnapshotGC.h"
 #include <map>
 #include <memory>
 #include <string>
@@ -19,6 +20,7 @@
 #include <shared_mutex>
 #include <thread>
 #include <atomic>
+#include <future>
 
 namespace milvus {
 namespace engine {
@@ -52,14 +54,17 @@ private:
     }
     void Init();
 
+    // Lookups take mutex_ shared. It is only taken exclusively to publish or remove a holder,
+    // never across a load round-trip through the executor
     mutable std::shared_timed_mutex mutex_;
-    SnapshotHolderPtr LoadNoLock(ID_TYPE collection_id);
+    SnapshotHolderPtr DoLoad(ID_TYPE collection_id);
     SnapshotHolderPtr Load(ID_TYPE collection_id);
-    SnapshotHolderPtr GetHolderNoLock(ID_TYPE collection_id);
+    SnapshotHolderPtr GetHolderNoLock(ID_TYPE collection_id) const;
 
     std::map<ID_TYPE, SnapshotHolderPtr> holders_;
     std::map<std::string, ID_TYPE> name_id_map_;
-    std::vector<Snapshot::Ptr> to_release_;
+    // In-flight loads. Concurrent misses on one collection wait on the first loader
+    std::map<ID_TYPE, std::shared_future<SnapshotHolderPtr>> loading_;
 };
 
 } // snapshot
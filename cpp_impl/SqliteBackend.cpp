@@ -0,0 +1,206 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#ifdef MILVUS_WITH_SQLITE
+#include "SqliteBackend.h"
+#include <sqlite3.h>
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+static const char* STATEMENT_SQLS[] = {
+    "BEGIN",
+    "COMMIT",
+    "ROLLBACK",
+    "INSERT OR REPLACE INTO resources (type, id, parent_id, record) VALUES (?, ?, ?, ?)",
+    "DELETE FROM resources WHERE type = ? AND id = ?",
+    "SELECT record FROM resources WHERE type = ? AND id = ?",
+    "SELECT id FROM resources WHERE type = ? ORDER BY id",
+    "SELECT id FROM resources WHERE type = ? AND parent_id = ? ORDER BY id",
+    "SELECT max_id FROM max_ids WHERE type = ?",
+    "INSERT INTO max_ids (type, max_id) VALUES (?, ?) "
+        "ON CONFLICT(type) DO UPDATE SET max_id = MAX(max_id, excluded.max_id)",
+};
+
+SqliteBackend::~SqliteBackend() {
+    Close();
+}
+
+bool
+SqliteBackend::Open(const std::string& dir, size_t) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (db_) return false;
+    auto path = dir + "/meta.db";
+    if (sqlite3_open(path.c_str(), &db_) != SQLITE_OK) {
+        std::cerr << "Failed to open " << path << ": " << sqlite3_errmsg(db_) << std::endl;
+        CloseNoLock();
+        return false;
+    }
+
+    // synchronous=FULL syncs the SQLite WAL on every commit, like LogBackend does
+    auto ok = ExecNoLock("PRAGMA journal_mode=WAL")
+        && ExecNoLock("PRAGMA synchronous=FULL")
+        && ExecNoLock("CREATE TABLE IF NOT EXISTS resources (type INTEGER NOT NULL, id INTEGER NOT NULL, "
+                      "parent_id INTEGER NOT NULL, record BLOB NOT NULL, PRIMARY KEY (type, id)) WITHOUT ROWID")
+        && ExecNoLock("CREATE INDEX IF NOT EXISTS resources_parent ON resources (type, parent_id, id)")
+        && ExecNoLock("CREATE TABLE IF NOT EXISTS max_ids (type INTEGER PRIMARY KEY, max_id INTEGER NOT NULL)");
+    for (int i = 0; ok && i < STATEMENT_NUM; ++i) {
+        ok = sqlite3_prepare_v2(db_, STATEMENT_SQLS[i], -1, &statements_[i], nullptr) == SQLITE_OK;
+    }
+    if (!ok) {
+        std::cerr << "Failed to initialize " << path << ": " << sqlite3_errmsg(db_) << std::endl;
+        CloseNoLock();
+    }
+    return ok;
+}
+
+void
+SqliteBackend::Close() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    CloseNoLock();
+}
+
+void
+SqliteBackend::CloseNoLock() {
+    for (auto& stmt : statements_) {
+        sqlite3_finalize(stmt);
+        stmt = nullptr;
+    }
+    sqlite3_close(db_);
+    db_ = nullptr;
+}
+
+bool
+SqliteBackend::ExecNoLock(const char* sql) {
+    return sqlite3_exec(db_, sql, nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+bool
+SqliteBackend::StepNoLock(sqlite3_stmt* stmt) {
+    auto rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return rc == SQLITE_DONE;
+}
+
+IDS_TYPE
+SqliteBackend::QueryIdsNoLock(sqlite3_stmt* stmt) {
+    IDS_TYPE ids;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        ids.push_back(sqlite3_column_int64(stmt, 0));
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return ids;
+}
+
+ID_TYPE
+SqliteBackend::GetMaxId(size_t type) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!db_) return 0;
+    auto stmt = statements_[GET_MAX_ID];
+    sqlite3_bind_int64(stmt, 1, type);
+    ID_TYPE id = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        id = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return id;
+}
+
+bool
+SqliteBackend::Get(size_t type, ID_TYPE id, std::string& record) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!db_) return false;
+    auto stmt = statements_[GET];
+    sqlite3_bind_int64(stmt, 1, type);
+    sqlite3_bind_int64(stmt, 2, id);
+    bool found = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto data = static_cast<const char*>(sqlite3_column_blob(stmt, 0));
+        record.assign(data, sqlite3_column_bytes(stmt, 0));
+        found = true;
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return found;
+}
+
+IDS_TYPE
+SqliteBackend::GetIds(size_t type) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!db_) return IDS_TYPE();
+    auto stmt = statements_[GET_IDS];
+    sqlite3_bind_int64(stmt, 1, type);
+    return QueryIdsNoLock(stmt);
+}
+
+IDS_TYPE
+SqliteBackend::GetIdsByParent(size_t type, ID_TYPE parent_id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!db_) return IDS_TYPE();
+    auto stmt = statements_[GET_IDS_BY_PARENT];
+    sqlite3_bind_int64(stmt, 1, type);
+    sqlite3_bind_int64(stmt, 2, parent_id);
+    return QueryIdsNoLock(stmt);
+}
+
+bool
+SqliteBackend::Commit(const std::string& batch) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!db_ || !StepNoLock(statements_[BEGIN])) return false;
+    std::map<size_t, ID_TYPE> max_ids;
+    auto ok = MetaBatch::ForEach(batch, [&](const MetaMutation& mutation) {
+        if (mutation.kind == MetaMutation::REMOVE) {
+            auto stmt = statements_[REMOVE];
+            sqlite3_bind_int64(stmt, 1, mutation.type);
+            sqlite3_bind_int64(stmt, 2, mutation.id);
+            return StepNoLock(stmt);
+        }
+        auto stmt = statements_[PUT];
+        sqlite3_bind_int64(stmt, 1, mutation.type);
+        sqlite3_bind_int64(stmt, 2, mutation.id);
+        sqlite3_bind_int64(stmt, 3, mutation.parent_id);
+        sqlite3_bind_blob(stmt, 4, mutation.data, mutation.size, SQLITE_STATIC);
+        auto& max_id = max_ids[mutation.type];
+        max_id = std::max(max_id, mutation.id);
+        return StepNoLock(stmt);
+    });
+    for (auto it = max_ids.begin(); ok && it != max_ids.end(); ++it) {
+        auto stmt = statements_[SET_MAX_ID];
+        sqlite3_bind_int64(stmt, 1, it->first);
+        sqlite3_bind_int64(stmt, 2, it->second);
+        ok = StepNoLock(stmt);
+    }
+    if (!ok || !StepNoLock(statements_[COMMIT])) {
+        std::cerr << "Failed to commit batch: " << sqlite3_errmsg(db_) << std::endl;
+        StepNoLock(statements_[ROLLBACK]);
+        return false;
+    }
+    return true;
+}
+
+bool
+SqliteBackend::Checkpoint() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!db_) return false;
+    return sqlite3_wal_checkpoint_v2(db_, nullptr, SQLITE_CHECKPOINT_TRUNCATE, nullptr, nullptr) == SQLITE_OK;
+}
+
+} // snapshot
+} // engine
+} // milvus
+#endif
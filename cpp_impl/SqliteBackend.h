@@ -0,0 +1,71 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+#ifdef MILVUS_WITH_SQLITE
+#include "MetaBackend.h"
+#include <mutex>
+#include <string>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+// Backend on an embedded SQLite database in WAL journal mode. All resource types share one
+// table keyed by (type, id) with a (type, parent id) index. A batch runs as one SQLite
+// transaction through prepared statements
+class SqliteBackend : public MetaBackend {
+public:
+    ~SqliteBackend() override;
+
+    bool Open(const std::string& dir, size_t type_num) override;
+    void Close() override;
+
+    ID_TYPE GetMaxId(size_t type) override;
+    bool Get(size_t type, ID_TYPE id, std::string& record) override;
+    IDS_TYPE GetIds(size_t type) override;
+    IDS_TYPE GetIdsByParent(size_t type, ID_TYPE parent_id) override;
+
+    bool Commit(const std::string& batch) override;
+    bool Checkpoint() override;
+
+private:
+    enum StatementT {
+        BEGIN,
+        COMMIT,
+        ROLLBACK,
+        PUT,
+        REMOVE,
+        GET,
+        GET_IDS,
+        GET_IDS_BY_PARENT,
+        GET_MAX_ID,
+        SET_MAX_ID,
+        STATEMENT_NUM,
+    };
+
+    bool ExecNoLock(const char* sql);
+    bool StepNoLock(sqlite3_stmt* stmt);
+    IDS_TYPE QueryIdsNoLock(sqlite3_stmt* stmt);
+    void CloseNoLock();
+
+    std::mutex mutex_;
+    sqlite3* db_ = nullptr;
+    sqlite3_stmt* statements_[STATEMENT_NUM] = {};
+};
+
+} // snapshot
+} // engine
+} // milvus
+#endif
@@ -12,6 +12,8 @@
 #pragma once
 #include "Resources.h"
 #include "ResourceTypes.h"
+#include "ResourceCodec.h"
+#include "MetaBackend.h"
 /* #include "schema.pb.h" */
 
 #include <iostream>
@@ -19,11 +21,18 @@
 #include <time.h>
 #include <sstream>
 #include <any>
-#include <typeindex>
+#include <variant>
 #include <typeinfo>
-#include <unordered_map>
+#include <unordered_set>
+#include <array>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+#include <iterator>
 #include <functional>
-#include <iomanip>
+#include <assert.h>
 
 namespace milvus {
 namespace engine {
@@ -42,22 +51,84 @@ struct Index<T, std::tuple<U, Types...>> {
     static const std::size_t value = 1 + Index<T, std::tuple<Types...>>::value;
 };
 
+// The parent a resource is indexed under in Store, e.g. a collection commit under its collection.
+// Types without a specialization are not indexed
+template <typename ResourceT>
+struct ParentIndex {
+    static constexpr bool Enabled = false;
+};
+
+template <>
+struct ParentIndex<CollectionCommit> {
+    static constexpr bool Enabled = true;
+    static ID_TYPE GetParentId(const CollectionCommit& r) { return r.GetCollectionId(); }
+};
+
+template <>
+struct ParentIndex<SchemaCommit> {
+    static constexpr bool Enabled = true;
+    static ID_TYPE GetParentId(const SchemaCommit& r) { return r.GetCollectionId(); }
+};
+
+template <>
+struct ParentIndex<FieldCommit> {
+    static constexpr bool Enabled = true;
+    static ID_TYPE GetParentId(const FieldCommit& r) { return r.GetFieldId(); }
+};
+
+template <>
+struct ParentIndex<FieldElement> {
+    static constexpr bool Enabled = true;
+    static ID_TYPE GetParentId(const FieldElement& r) { return r.GetFieldId(); }
+};
+
+template <>
+struct ParentIndex<Partition> {
+    static constexpr bool Enabled = true;
+    static ID_TYPE GetParentId(const Partition& r) { return r.GetCollectionId(); }
+};
+
+template <>
+struct ParentIndex<PartitionCommit> {
+    static constexpr bool Enabled = true;
+    static ID_TYPE GetParentId(const PartitionCommit& r) { return r.GetPartitionId(); }
+};
+
+template <>
+struct ParentIndex<Segment> {
+    static constexpr bool Enabled = true;
+    static ID_TYPE GetParentId(const Segment& r) { return r.GetPartitionId(); }
+};
+
+template <>
+struct ParentIndex<SegmentCommit> {
+    static constexpr bool Enabled = true;
+    static ID_TYPE GetParentId(const SegmentCommit& r) { return r.GetSegmentId(); }
+};
+
+template <>
+struct ParentIndex<SegmentFile> {
+    static constexpr bool Enabled = true;
+    static ID_TYPE GetParentId(const SegmentFile& r) { return r.GetSegmentId(); }
+};
 
 class Store {
 public:
     using MockIDST = std::tuple<ID_TYPE, ID_TYPE, ID_TYPE, ID_TYPE, ID_TYPE, ID_TYPE, ID_TYPE,
                                 ID_TYPE, ID_TYPE, ID_TYPE, ID_TYPE>;
-    using MockResourcesT = std::tuple<CollectionCommit::MapT,
-                                  Collection::MapT,
-                                  SchemaCommit::MapT,
-                                  FieldCommit::MapT,
-                                  Field::MapT,
-                                  FieldElement::MapT,
-                                  PartitionCommit::MapT,
-                                  Partition::MapT,
-                                  SegmentCommit::MapT,
-                                  Segment::MapT,
-                                  SegmentFile::MapT>;
+    using MockResourcesT = AllResourcesT::MapsT;
+    // Per resource type: parent id -> ids, see ParentIndex
+    using ChildIdsT = std::map<ID_TYPE, std::set<ID_TYPE>>;
+    using MockIndexesT = std::array<ChildIdsT, std::tuple_size<MockResourcesT>::value>;
+    // Per resource type: ids removed from the store whose removal the backend has not committed yet
+    using RemovedIdsT = std::array<std::unordered_set<ID_TYPE>, std::tuple_size<MockResourcesT>::value>;
+    // The commits of one delta chain, see RemoveCommitNoLock
+    struct CommitChain {
+        std::set<ID_TYPE> live;
+        std::set<ID_TYPE> removed;
+    };
+    // Per commit type: base commit id -> chain
+    using CommitChainsT = std::array<std::map<ID_TYPE, CommitChain>, std::tuple_size<MockResourcesT>::value>;
 
     static Store& GetInstance() {
         static Store store;
@@ -70,17 +141,24 @@ public:
         auto& t_size = std::tuple_size<decltype(t)>::value;
         if (t_size == 0) return false;
         StartTransanction();
-        std::apply([this](auto&&... resource) {((std::cout << CommitResource(resource) << "\n"), ...);}, t);
-        FinishTransaction();
-        return true;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            std::apply([this](auto&&... resource) {((std::cout << CommitResourceNoLock(resource) << "\n"), ...);}, t);
+        }
+        return FinishTransaction();
     }
 
     template <typename OpT>
     bool DoCommitOperation(OpT& op) {
-        for(auto& step_v : op.GetSteps()) {
-            auto id = ProcessOperationStep(step_v);
-            op.SetStepResult(id);
+        StartTransanction();
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            for(auto& step_v : op.GetSteps()) {
+                auto id = ProcessOperationStep(step_v);
+                op.SetStepResult(id);
+            }
         }
+        return FinishTransaction();
     }
 
     template <typename OpT>
@@ -88,70 +166,158 @@ public:
         op.ApplyToStore(*this);
     }
 
-    void StartTransanction() {}
-    void FinishTransaction() {}
+    // Transactions nest per thread and only the outermost pair commits. This lets the executor
+    // wrap a whole batch of operations, each committing through DoCommitOperation, in one transaction
+    void StartTransanction() {
+        ++transaction_depth_;
+    }
+
+    // With a backend, the outermost Finish commits every change made in the transaction as one
+    // batch. Returns false if the backend failed to commit it, in which case the changes are
+    // rolled back in memory as well
+    bool FinishTransaction() {
+        assert(transaction_depth_ > 0);
+        if (--transaction_depth_ > 0) return true;
+        ++transactions_;
+        std::vector<std::function<void()>> undo;
+        undo.swap(transaction_undo_);
+        if (transaction_record_.empty()) return true;
+        std::string batch;
+        batch.swap(transaction_record_);
+        std::vector<std::pair<size_t, ID_TYPE>> removed;
+        removed.swap(transaction_removed_);
+
+        MetaBackend::Ptr backend;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            backend = backend_;
+        }
+        if (!backend || !backend->Commit(batch)) {
+            std::cerr << "Store: failed to commit transaction " << transactions_ << std::endl;
+            std::unique_lock<std::mutex> lock(mutex_);
+            for (auto it = undo.rbegin(); it != undo.rend(); ++it) {
+                (*it)();
+            }
+            for (auto& type_id : removed) {
+                removed_[type_id.first].erase(type_id.second);
+            }
+            return false;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (auto& type_id : removed) {
+            removed_[type_id.first].erase(type_id.second);
+        }
+        return true;
+    }
+
+    size_t GetTransactionCount() const { return transactions_; }
+
+    // Back the store with `backend`, opened in `dir`. Resources the store has not seen are loaded
+    // from the backend on first access and every committed change is written to it. Must be
+    // called before anything is created in the store
+    bool Open(const MetaBackend::Ptr& backend, const std::string& dir) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (backend_) return false;
+        if (!backend->Open(dir, std::tuple_size<MockResourcesT>::value)) return false;
+        backend_ = backend;
+        if (!LoadBackendNoLock(std::make_index_sequence<std::tuple_size<MockResourcesT>::value>())) {
+            std::cerr << "Store: failed to load metadata from " << dir << std::endl;
+            backend_->Close();
+            backend_.reset();
+            return false;
+        }
+        return true;
+    }
+
+    void Close() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!backend_) return;
+        backend_->Close();
+        backend_.reset();
+    }
+
+    // Let the backend compact what it accumulated, e.g. fold its log into a new checkpoint
+    bool Checkpoint() {
+        MetaBackend::Ptr backend;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            backend = backend_;
+        }
+        return backend && backend->Checkpoint();
+    }
 
     template<typename ResourceT>
     bool CommitResource(ResourceT&& resource) {
-        std::cout << "Commit " << resource.Name << " " << resource.GetID() << std::endl;
-        auto res = CreateResource<typename std::remove_reference<ResourceT>::type>(std::move(resource));
-        if (!res) return false;
-        return true;
+        StartTransanction();
+        bool ok;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ok = CommitResourceNoLock(std::forward<ResourceT>(resource));
+        }
+        return FinishTransaction() && ok;
     }
 
+    // Committed resources are frozen: loads share the stored object instead of copying it, and
+    // an update stores a new object. Callers must copy a resource before changing it
     template<typename ResourceT>
     std::shared_ptr<ResourceT>
     GetResource(ID_TYPE id) {
-        auto& resources = std::get<Index<typename ResourceT::MapT, MockResourcesT>::value>(resources_);
-        auto it = resources.find(id);
-        if (it== resources.end()) {
-            return nullptr;
+        std::unique_lock<std::mutex> lock(mutex_);
+        return GetResourceNoLock<ResourceT>(id);
+    }
+
+    // One result per id, in order, nullptr where there is none. Takes the lock once for all
+    template<typename ResourceT>
+    typename ResourceT::VecT
+    GetResources(const IDS_TYPE& ids) {
+        typename ResourceT::VecT resources;
+        resources.reserve(ids.size());
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (auto id : ids) {
+            resources.push_back(GetResourceNoLock<ResourceT>(id));
         }
-        auto& c = it->second;
-        auto ret = std::make_shared<ResourceT>(*c);
-        std::cout << "<<< [Load] " << ResourceT::Name << " " << id << " IsActive=" << ret->IsActive() << std::endl;
-        return ret;
+        return resources;
     }
 
     CollectionPtr GetCollection(const std::string& name) {
+        std::unique_lock<std::mutex> lock(mutex_);
         auto it = name_collections_.find(name);
         if (it == name_collections_.end()) {
             return nullptr;
         }
-        auto& c = it->second;
-        auto ret = std::make_shared<Collection>(*c);
-        std::cout << "<<< [Load] Collection " << name << std::endl;
-        return ret;
+        return it->second;
     }
 
     bool RemoveCollection(ID_TYPE id) {
-        auto& resources = std::get<Collection::MapT>(resources_);
-        auto it = resources.find(id);
-        if (it == resources.end()) {
-            return false;
-        }
-
-        auto name = it->second->GetName();
-        resources.erase(it);
-        name_collections_.erase(name);
-        std::cout << ">>> [Remove] Collection " << id << std::endl;
-        return true;
+        return RemoveResource<Collection>(id);
     }
 
     template<typename ResourceT>
     bool RemoveResource(ID_TYPE id) {
-        auto& resources = std::get<Index<typename ResourceT::MapT, MockResourcesT>::value>(resources_);
-        auto it = resources.find(id);
-        if (it == resources.end()) {
-            return false;
-        }
+        return RemoveResources<ResourceT>({id});
+    }
 
-        resources.erase(it);
-        std::cout << ">>> [Remove] " << ResourceT::Name << " " << id << std::endl;
-        return true;
+    // All in one transaction. False if any of them could not be removed
+    template<typename ResourceT>
+    bool RemoveResources(const IDS_TYPE& ids) {
+        StartTransanction();
+        IDS_TYPE removed;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            for (auto id : ids) {
+                if (RemoveResourceNoLock<ResourceT>(id)) removed.push_back(id);
+            }
+        }
+        if (!FinishTransaction()) return false;
+        for (auto id : removed) {
+            std::cout << ">>> [Remove] " << ResourceT::Name << " " << id << std::endl;
+        }
+        return removed.size() == ids.size();
     }
 
     IDS_TYPE AllActiveCollectionIds(bool reversed = true) const {
+        std::unique_lock<std::mutex> lock(mutex_);
         IDS_TYPE ids;
         auto& resources = std::get<Collection::MapT>(resources_);
         if (!reversed) {
@@ -166,61 +332,60 @@ public:
         return ids;
     }
 
-    IDS_TYPE AllActiveCollectionCommitIds(ID_TYPE collection_id, bool reversed = true) const {
+    IDS_TYPE AllActiveCollectionCommitIds(ID_TYPE collection_id, bool reversed = true) {
+        std::unique_lock<std::mutex> lock(mutex_);
         IDS_TYPE ids;
-        auto& resources = std::get<CollectionCommit::MapT>(resources_);
-        if (!reversed) {
-            for (auto& kv : resources) {
-                if (kv.second->GetCollectionId() == collection_id) {
-                    ids.push_back(kv.first);
-                }
-            }
-        } else {
-            for (auto kv = resources.rbegin(); kv != resources.rend(); ++kv) {
-                if (kv->second->GetCollectionId() == collection_id) {
-                    ids.push_back(kv->first);
-                }
-            }
+        // Deactivated commits are removed ones kept for the delta chain of a live commit
+        for (auto id : GetResourceIdsByParentNoLock<CollectionCommit>(collection_id, reversed)) {
+            auto collection_commit = GetResourceNoLock<CollectionCommit>(id);
+            if (collection_commit && !collection_commit->IsDeactive()) ids.push_back(id);
         }
         return ids;
     }
 
+    // Ids of all `ResourceT` under `parent_id`, in O(result size). See ParentIndex for the parent
+    // of each type
+    template <typename ResourceT>
+    IDS_TYPE GetResourceIdsByParent(ID_TYPE parent_id, bool reversed = false) const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return GetResourceIdsByParentNoLock<ResourceT>(parent_id, reversed);
+    }
+
     CollectionPtr CreateCollection(Collection&& collection) {
-        auto& resources = std::get<Collection::MapT>(resources_);
-        auto c = std::make_shared<Collection>(collection);
-        auto& id = std::get<Index<Collection::MapT, MockResourcesT>::value>(ids_);
-        c->SetID(++id);
-        c->ResetCnt();
-        resources[c->GetID()] = c;
-        name_collections_[c->GetName()] = c;
-        return GetResource<Collection>(c->GetID());
+        StartTransanction();
+        CollectionPtr c;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            c = CreateCollectionNoLock(std::move(collection));
+        }
+        if (!FinishTransaction()) return nullptr;
+        return c;
     }
 
     template <typename ResourceT>
     typename ResourceT::Ptr
     UpdateResource(ResourceT&& resource) {
-        auto& resources = std::get<typename ResourceT::MapT>(resources_);
-        auto res = std::make_shared<ResourceT>(resource);
-        auto& id = std::get<Index<typename ResourceT::MapT, MockResourcesT>::value>(ids_);
-        res->ResetCnt();
-        resources[res->GetID()] = res;
-        return GetResource<ResourceT>(res->GetID());
+        StartTransanction();
+        typename ResourceT::Ptr res;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            res = UpdateResourceNoLock<ResourceT>(std::move(resource));
+        }
+        if (!FinishTransaction()) return nullptr;
+        return res;
     }
 
-
     template <typename ResourceT>
     typename ResourceT::Ptr
     CreateResource(ResourceT&& resource) {
-        if (resource.HasAssigned()) {
-            return UpdateResource<ResourceT>(std::move(resource));
+        StartTransanction();
+        typename ResourceT::Ptr res;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            res = CreateResourceNoLock<ResourceT>(std::move(resource));
         }
-        auto& resources = std::get<typename ResourceT::MapT>(resources_);
-        auto res = std::make_shared<ResourceT>(resource);
-        auto& id = std::get<Index<typename ResourceT::MapT, MockResourcesT>::value>(ids_);
-        res->SetID(++id);
-        res->ResetCnt();
-        resources[res->GetID()] = res;
-        return GetResource<ResourceT>(res->GetID());
+        if (!FinishTransaction()) return nullptr;
+        return res;
     }
 
     /* CollectionPtr CreateCollection(const schema::CollectionSchemaPB& collection_schema) { */
@@ -259,82 +424,331 @@ public:
     /*     return collection; */
     /* } */
 
-    void Mock() { DoMock(); }
+    void Mock() {
+        StartTransanction();
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            DoMock();
+        }
+        FinishTransaction();
+    }
 
 private:
+    template<typename ResourceT>
+    bool CommitResourceNoLock(ResourceT&& resource) {
+        std::cout << "Commit " << resource.Name << " " << resource.GetID() << std::endl;
+        auto res = CreateResourceNoLock<typename std::remove_reference<ResourceT>::type>(std::move(resource));
+        if (!res) return false;
+        return true;
+    }
 
-    ID_TYPE ProcessOperationStep(const std::any& step_v) {
-        if (const auto it = any_flush_vistors_.find(std::type_index(step_v.type()));
-                it != any_flush_vistors_.cend()) {
-            return it->second(step_v);
+    template<typename ResourceT>
+    std::shared_ptr<ResourceT>
+    GetResourceNoLock(ID_TYPE id) {
+        auto& resources = std::get<Index<typename ResourceT::MapT, MockResourcesT>::value>(resources_);
+        auto it = resources.find(id);
+        if (it== resources.end()) {
+            return LoadFromBackendNoLock<ResourceT>(id);
+        }
+        return it->second;
+    }
+
+    // Decode a resource the store has not seen yet from the backend and keep it in resources_
+    template<typename ResourceT>
+    std::shared_ptr<ResourceT>
+    LoadFromBackendNoLock(ID_TYPE id) {
+        static constexpr auto I = Index<typename ResourceT::MapT, MockResourcesT>::value;
+        if (!backend_ || removed_[I].count(id) > 0) return nullptr;
+        std::string record;
+        if (!backend_->Get(I, id, record)) return nullptr;
+        BinaryReader reader(record.data(), record.size());
+        auto res = ResourceCodec<ResourceT>::Decode(reader);
+        if (!res) return nullptr;
+        if constexpr (std::is_base_of<DeltaMappingsField, ResourceT>::value) {
+            if (res->IsDelta()) {
+                // Loads the chain up to its first full commit, at most max delta depth commits
+                auto parent = GetResourceNoLock<ResourceT>(res->GetParentCommitId());
+                if (!parent) return nullptr;
+                res->Materialize(parent->GetMappings());
+            }
+        }
+        PutResourceNoLock(res);
+        return res;
+    }
+
+    CollectionPtr CreateCollectionNoLock(Collection&& collection) {
+        auto c = std::make_shared<Collection>(collection);
+        auto& id = std::get<Index<Collection::MapT, MockResourcesT>::value>(ids_);
+        c->SetID(++id);
+        PutResourceNoLock(c);
+        LogPutNoLock(*c);
+        return c;
+    }
+
+    template <typename ResourceT>
+    IDS_TYPE GetResourceIdsByParentNoLock(ID_TYPE parent_id, bool reversed) const {
+        static_assert(ParentIndex<ResourceT>::Enabled, "resource type has no parent index");
+        static constexpr auto I = Index<typename ResourceT::MapT, MockResourcesT>::value;
+        IDS_TYPE ids;
+        auto& index = indexes_[I];
+        auto it = index.find(parent_id);
+        if (it != index.end()) {
+            ids.assign(it->second.begin(), it->second.end());
+        }
+        if (backend_) {
+            // Resources in both lists are the same, except for removals the backend has not
+            // committed yet
+            IDS_TYPE backend_ids;
+            for (auto id : backend_->GetIdsByParent(I, parent_id)) {
+                if (removed_[I].count(id) == 0) backend_ids.push_back(id);
+            }
+            if (!backend_ids.empty()) {
+                IDS_TYPE merged;
+                merged.reserve(ids.size() + backend_ids.size());
+                std::set_union(ids.begin(), ids.end(), backend_ids.begin(), backend_ids.end(),
+                        std::back_inserter(merged));
+                ids.swap(merged);
+            }
+        }
+        if (reversed) {
+            std::reverse(ids.begin(), ids.end());
+        }
+        return ids;
+    }
+
+    template <typename ResourceT>
+    void AddToIndexNoLock(const ResourceT& resource) {
+        if constexpr (ParentIndex<ResourceT>::Enabled) {
+            auto& index = indexes_[Index<typename ResourceT::MapT, MockResourcesT>::value];
+            index[ParentIndex<ResourceT>::GetParentId(resource)].insert(resource.GetID());
+        }
+        if constexpr (std::is_base_of<DeltaMappingsField, ResourceT>::value) {
+            auto& chain = chains_[Index<typename ResourceT::MapT, MockResourcesT>::value][GetChainId(resource)];
+            if (resource.IsDeactive()) {
+                chain.removed.insert(resource.GetID());
+            } else {
+                chain.live.insert(resource.GetID());
+            }
+        }
+    }
+
+    template <typename ResourceT>
+    void RemoveFromIndexNoLock(const ResourceT& resource) {
+        if constexpr (std::is_base_of<DeltaMappingsField, ResourceT>::value) {
+            auto& chains = chains_[Index<typename ResourceT::MapT, MockResourcesT>::value];
+            auto it = chains.find(GetChainId(resource));
+            if (it != chains.end()) {
+                it->second.live.erase(resource.GetID());
+                it->second.removed.erase(resource.GetID());
+                if (it->second.live.empty() && it->second.removed.empty()) chains.erase(it);
+            }
+        }
+        if constexpr (ParentIndex<ResourceT>::Enabled) {
+            auto& index = indexes_[Index<typename ResourceT::MapT, MockResourcesT>::value];
+            auto it = index.find(ParentIndex<ResourceT>::GetParentId(resource));
+            if (it == index.end()) return;
+            it->second.erase(resource.GetID());
+            if (it->second.empty()) index.erase(it);
+        }
+    }
+
+    template <typename ResourceT>
+    static ID_TYPE GetChainId(const ResourceT& resource) {
+        return resource.IsDelta() ? resource.GetBaseCommitId() : resource.GetID();
+    }
+
+    // Store `res`, replacing any resource with the same id. Does not log
+    template <typename ResourceT>
+    void PutResourceNoLock(const std::shared_ptr<ResourceT>& res) {
+        SaveUndoNoLock<ResourceT>(res->GetID());
+        auto& resources = std::get<typename ResourceT::MapT>(resources_);
+        auto it = resources.find(res->GetID());
+        if (it != resources.end()) {
+            RemoveFromIndexNoLock(*it->second);
+            if constexpr (std::is_same<ResourceT, Collection>::value) {
+                name_collections_.erase(it->second->GetName());
+            }
+        }
+        resources[res->GetID()] = res;
+        AddToIndexNoLock(*res);
+        if constexpr (std::is_same<ResourceT, Collection>::value) {
+            name_collections_[res->GetName()] = res;
+        }
+    }
+
+    // Remember how to bring resource `id` back to its current state, should the transaction fail
+    template <typename ResourceT>
+    void SaveUndoNoLock(ID_TYPE id) {
+        if (!backend_ || transaction_depth_ == 0) return;
+        auto& resources = std::get<typename ResourceT::MapT>(resources_);
+        auto it = resources.find(id);
+        std::shared_ptr<ResourceT> prev = it == resources.end() ? nullptr : it->second;
+        transaction_undo_.push_back([this, id, prev]() { RestoreResourceNoLock<ResourceT>(id, prev); });
+    }
+
+    template <typename ResourceT>
+    void RestoreResourceNoLock(ID_TYPE id, const std::shared_ptr<ResourceT>& prev) {
+        auto& resources = std::get<typename ResourceT::MapT>(resources_);
+        auto it = resources.find(id);
+        if (it != resources.end()) {
+            RemoveFromIndexNoLock(*it->second);
+            if constexpr (std::is_same<ResourceT, Collection>::value) {
+                name_collections_.erase(it->second->GetName());
+            }
+            resources.erase(it);
+        }
+        if (prev) PutResourceNoLock(prev);
+    }
+
+    template <typename ResourceT>
+    bool RemoveResourceNoLock(ID_TYPE id) {
+        if constexpr (std::is_base_of<DeltaMappingsField, ResourceT>::value) {
+            return RemoveCommitNoLock<ResourceT>(id);
+        } else {
+            return EraseResourceNoLock<ResourceT>(id);
+        }
+    }
+
+    // Commits of one delta chain are rebuilt from each other, so they are erased together once
+    // all of them have been removed. Until then a removed commit is kept, deactivated. chains_
+    // tracks the live and removed commits of every chain in memory
+    template <typename ResourceT>
+    bool RemoveCommitNoLock(ID_TYPE id) {
+        static constexpr auto I = Index<typename ResourceT::MapT, MockResourcesT>::value;
+        auto res = GetResourceNoLock<ResourceT>(id);
+        if (!res) return false;
+        LoadChainsNoLock<ResourceT>(GetParentId(*res));
+        auto& chain = chains_[I][GetChainId(*res)];
+        if (chain.live.size() > (chain.live.count(id) > 0 ? 1 : 0)) {
+            if (res->IsDeactive()) return true;
+            auto retired = std::make_shared<ResourceT>(*res);
+            retired->Deactivate();
+            PutResourceNoLock(retired);
+            LogPutNoLock(*retired);
+            return true;
+        }
+        IDS_TYPE removed_ids(chain.removed.begin(), chain.removed.end());
+        if (chain.removed.count(id) == 0) removed_ids.push_back(id);
+        for (auto removed_id : removed_ids) {
+            EraseResourceNoLock<ResourceT>(removed_id);
+        }
+        return true;
+    }
+
+    // A chain only holds the commits in memory. Load the ones under `parent_id` from the backend
+    // once, after which every commit under it is in memory and its chain complete
+    template <typename ResourceT>
+    void LoadChainsNoLock(ID_TYPE parent_id) {
+        static constexpr auto I = Index<typename ResourceT::MapT, MockResourcesT>::value;
+        if (!backend_ || !chained_parents_[I].insert(parent_id).second) return;
+        for (auto commit_id : backend_->GetIdsByParent(I, parent_id)) {
+            GetResourceNoLock<ResourceT>(commit_id);
+        }
+    }
+
+    template <typename ResourceT>
+    bool EraseResourceNoLock(ID_TYPE id) {
+        auto& resources = std::get<typename ResourceT::MapT>(resources_);
+        auto it = resources.find(id);
+        if (it == resources.end()) {
+            if (!LoadFromBackendNoLock<ResourceT>(id)) return false;
+            it = resources.find(id);
+        }
+
+        SaveUndoNoLock<ResourceT>(id);
+        RemoveFromIndexNoLock(*it->second);
+        if constexpr (std::is_same<ResourceT, Collection>::value) {
+            name_collections_.erase(it->second->GetName());
+        }
+        resources.erase(it);
+        LogRemoveNoLock<ResourceT>(id);
+        return true;
+    }
+
+    template <typename ResourceT>
+    typename ResourceT::Ptr
+    UpdateResourceNoLock(ResourceT&& resource) {
+        auto res = std::make_shared<ResourceT>(resource);
+        PutResourceNoLock(res);
+        LogPutNoLock(*res);
+        return res;
+    }
+
+    template <typename ResourceT>
+    typename ResourceT::Ptr
+    CreateResourceNoLock(ResourceT&& resource) {
+        if (resource.HasAssigned()) {
+            return UpdateResourceNoLock<ResourceT>(std::move(resource));
+        }
+        auto res = std::make_shared<ResourceT>(resource);
+        auto& id = std::get<Index<typename ResourceT::MapT, MockResourcesT>::value>(ids_);
+        res->SetID(++id);
+        PutResourceNoLock(res);
+        LogPutNoLock(*res);
+        return res;
+    }
+
+    template <typename ResourceT>
+    static ID_TYPE GetParentId(const ResourceT& resource) {
+        if constexpr (ParentIndex<ResourceT>::Enabled) {
+            return ParentIndex<ResourceT>::GetParentId(resource);
         } else {
-            std::cerr << "Unregisted step type " << std::quoted(step_v.type().name());
             return 0;
         }
     }
 
-    template<class T, class F>
-    inline std::pair<const std::type_index, std::function<ID_TYPE(std::any const&)>>
-        to_any_visitor(F const &f)
-    {
-        return {
-            std::type_index(typeid(T)),
-            [g = f](std::any const &a) -> ID_TYPE
-            {
-                if constexpr (std::is_void_v<T>)
-                    return g();
-                else
-                    return g(std::any_cast<T const&>(a));
-            }
-        };
-    }
-
-    template<class T, class F>
-    inline void register_any_visitor(F const& f)
-    {
-        std::cout << "Register visitor for type "
-                  << std::quoted(typeid(T).name()) << '\n';
-        any_flush_vistors_.insert(to_any_visitor<T>(f));
-    }
-
-    Store() {
-        register_any_visitor<Collection::Ptr>([this](auto c) {
-            auto n = CreateResource<Collection>(Collection(*c));
-            return n->GetID();
-        });
-        register_any_visitor<CollectionCommit::Ptr>([this](auto c) {
-            return CreateResource<CollectionCommit>(CollectionCommit(*c))->GetID();
-        });
-        /* register_any_visitor<SchemaCommit::Ptr>([this](auto c) { */
-        /*     CreateResource<SchemaCommit>(SchemaCommit(*c)); */
-        /* }); */
-        /* register_any_visitor<FieldCommit::Ptr>([this](auto c) { */
-        /*     CreateResource<FieldCommit>(FieldCommit(*c)); */
-        /* }); */
-        /* register_any_visitor<Field::Ptr>([this](auto c) { */
-        /*     CreateResource<Field>(Field(*c)); */
-        /* }); */
-        /* register_any_visitor<FieldElement::Ptr>([this](auto c) { */
-        /*     CreateResource<FieldElement>(FieldElement(*c)); */
-        /* }); */
-        register_any_visitor<PartitionCommit::Ptr>([this](auto c) {
-            return CreateResource<PartitionCommit>(PartitionCommit(*c))->GetID();
-        });
-        /* register_any_visitor<Partition::Ptr>([this](auto c) { */
-        /*     CreateResource<Partition>(Partition(*c)); */
-        /* }); */
-        register_any_visitor<Segment::Ptr>([this](auto c) {
-            return CreateResource<Segment>(Segment(*c))->GetID();
-        });
-        register_any_visitor<SegmentCommit::Ptr>([this](auto c) {
-            return CreateResource<SegmentCommit>(SegmentCommit(*c))->GetID();
-        });
-        register_any_visitor<SegmentFile::Ptr>([this](auto c) {
-            auto n = CreateResource<SegmentFile>(SegmentFile(*c));
-            return n->GetID();
-        });
+    template <typename ResourceT>
+    void LogPutNoLock(const ResourceT& resource) {
+        if (!backend_) return;
+        assert(transaction_depth_ > 0);
+        MetaBatch batch(transaction_record_);
+        batch.Put(Index<typename ResourceT::MapT, MockResourcesT>::value, GetParentId(resource), resource);
     }
 
+    template <typename ResourceT>
+    void LogRemoveNoLock(ID_TYPE id) {
+        if (!backend_) return;
+        assert(transaction_depth_ > 0);
+        static constexpr auto I = Index<typename ResourceT::MapT, MockResourcesT>::value;
+        MetaBatch batch(transaction_record_);
+        batch.Remove(I, id);
+        // Until the backend commits the removal, reads must not load the resource from it
+        removed_[I].insert(id);
+        transaction_removed_.emplace_back(I, id);
+    }
+
+    // Nothing is loaded but the collections, which are few and looked up by name
+    template <size_t ...I>
+    bool LoadBackendNoLock(std::index_sequence<I...>) {
+        ((std::get<I>(ids_) = backend_->GetMaxId(I)), ...);
+        for (auto id : backend_->GetIds(Index<Collection::MapT, MockResourcesT>::value)) {
+            if (!LoadFromBackendNoLock<Collection>(id)) return false;
+        }
+        return true;
+    }
+
+
+    template <typename StepT>
+    ID_TYPE ProcessOperationStep(const StepT& step) {
+        return std::visit([this](auto& resource) { return AdoptResourceNoLock(resource)->GetID(); }, step);
+    }
+
+    // Store a step as is: the operation is done with it once it commits, so unlike
+    // CreateResourceNoLock no copy is made
+    template <typename ResourceT>
+    const std::shared_ptr<ResourceT>&
+    AdoptResourceNoLock(const std::shared_ptr<ResourceT>& res) {
+        if (!res->HasAssigned()) {
+            auto& id = std::get<Index<typename ResourceT::MapT, MockResourcesT>::value>(ids_);
+            res->SetID(++id);
+        }
+        PutResourceNoLock(res);
+        LogPutNoLock(*res);
+        return res;
+    }
+
+    Store() = default;
+
     void DoMock() {
         srand(time(0));
         int random;
@@ -344,7 +758,7 @@ private:
             std::stringstream name;
             name << "c_" << std::get<Index<Collection::MapT, MockResourcesT>::value>(ids_) + 1;
 
-            auto c = CreateCollection(Collection(name.str()));
+            auto c = CreateCollectionNoLock(Collection(name.str()));
             all_records.push_back(c);
 
             MappingT schema_c_m;
@@ -352,7 +766,7 @@ private:
             for (auto fi=1; fi<=random_fields; ++fi) {
                 std::stringstream fname;
                 fname << "f_" << fi << "_" << std::get<Index<Field::MapT, MockResourcesT>::value>(ids_) + 1;
-                auto field = CreateResource<Field>(Field(fname.str(), fi));
+                auto field = CreateResourceNoLock<Field>(Field(fname.str(), fi));
                 all_records.push_back(field);
                 MappingT f_c_m = {};
 
@@ -361,16 +775,16 @@ private:
                     std::stringstream fename;
                     fename << "fe_" << fei << "_" << std::get<Index<FieldElement::MapT, MockResourcesT>::value>(ids_) + 1;
 
-                    auto element = CreateResource<FieldElement>(FieldElement(c->GetID(), field->GetID(), fename.str(), fei));
+                    auto element = CreateResourceNoLock<FieldElement>(FieldElement(c->GetID(), field->GetID(), fename.str(), fei));
                     all_records.push_back(element);
                     f_c_m.insert(element->GetID());
                 }
-                auto f_c = CreateResource<FieldCommit>(FieldCommit(c->GetID(), field->GetID(), f_c_m));
+                auto f_c = CreateResourceNoLock<FieldCommit>(FieldCommit(c->GetID(), field->GetID(), f_c_m));
                 all_records.push_back(f_c);
                 schema_c_m.insert(f_c->GetID());
             }
 
-            auto schema = CreateResource<SchemaCommit>(SchemaCommit(c->GetID(), schema_c_m));
+            auto schema = CreateResourceNoLock<SchemaCommit>(SchemaCommit(c->GetID(), schema_c_m));
             all_records.push_back(schema);
 
 
@@ -379,14 +793,14 @@ private:
             for (auto pi=1; pi<=random_partitions; ++pi) {
                 std::stringstream pname;
                 pname << "p_" << i << "_" << std::get<Index<Partition::MapT, MockResourcesT>::value>(ids_) + 1;
-                auto p = CreateResource<Partition>(Partition(pname.str(), c->GetID()));
+                auto p = CreateResourceNoLock<Partition>(Partition(pname.str(), c->GetID()));
                 all_records.push_back(p);
 
 
                 int random_segments = rand() % 2 + 1;
                 MappingT p_c_m;
                 for (auto si=1; si<=random_segments; ++si) {
-                    auto s = CreateResource<Segment>(Segment(p->GetID(), si));
+                    auto s = CreateResourceNoLock<Segment>(Segment(p->GetID(), si));
                     all_records.push_back(s);
                     auto& schema_m = schema->GetMappings();
                     MappingT s_c_m;
@@ -394,38 +808,56 @@ private:
                         auto& field_commit = std::get<FieldCommit::MapT>(resources_)[field_commit_id];
                         auto& f_c_m = field_commit->GetMappings();
                         for (auto field_element_id : f_c_m) {
-                            auto sf = CreateResource<SegmentFile>(SegmentFile(p->GetID(), s->GetID(), field_commit_id));
+                            auto sf = CreateResourceNoLock<SegmentFile>(SegmentFile(p->GetID(), s->GetID(), field_commit_id));
                             all_records.push_back(sf);
 
                             s_c_m.insert(sf->GetID());
                         }
                     }
-                    auto s_c = CreateResource<SegmentCommit>(SegmentCommit(schema->GetID(), p->GetID(), s->GetID(), s_c_m));
+                    auto s_c = CreateResourceNoLock<SegmentCommit>(SegmentCommit(schema->GetID(), p->GetID(), s->GetID(), s_c_m));
                     all_records.push_back(s_c);
                     p_c_m.insert(s_c->GetID());
                 }
-                auto p_c = CreateResource<PartitionCommit>(PartitionCommit(c->GetID(), p->GetID(), p_c_m));
+                auto p_c = CreateResourceNoLock<PartitionCommit>(PartitionCommit(c->GetID(), p->GetID(), p_c_m));
                 all_records.push_back(p_c);
                 c_c_m.insert(p_c->GetID());
             }
-            auto c_c = CreateResource<CollectionCommit>(CollectionCommit(c->GetID(), schema->GetID(), c_c_m));
+            auto c_c = CreateResourceNoLock<CollectionCommit>(CollectionCommit(c->GetID(), schema->GetID(), c_c_m));
             all_records.push_back(c_c);
         }
+        // Stored resources are frozen, so activation stores activated copies
         for (auto& record : all_records) {
             if (record.type() == typeid(std::shared_ptr<Collection>)) {
-                const auto& r = std::any_cast<std::shared_ptr<Collection>>(record);
-                r->Activate();
+                Collection r(*std::any_cast<std::shared_ptr<Collection>>(record));
+                r.Activate();
+                UpdateResourceNoLock<Collection>(std::move(r));
             } else if (record.type() == typeid(std::shared_ptr<CollectionCommit>)) {
-                const auto& r = std::any_cast<std::shared_ptr<CollectionCommit>>(record);
-                r->Activate();
+                CollectionCommit r(*std::any_cast<std::shared_ptr<CollectionCommit>>(record));
+                r.Activate();
+                UpdateResourceNoLock<CollectionCommit>(std::move(r));
             }
         }
     }
 
+    // Operations on different executor lanes may reach the store concurrently
+    mutable std::mutex mutex_;
+    inline static thread_local int transaction_depth_ = 0;
+    std::atomic<size_t> transactions_ = 0;
+    // Changes made by the current transaction of this thread, a MetaBatch
+    inline static thread_local std::string transaction_record_;
+    inline static thread_local std::vector<std::pair<size_t, ID_TYPE>> transaction_removed_;
+    // Undoes the in-memory changes of the current transaction of this thread, newest last. Only
+    // kept with a backend, as only a backend commit can fail
+    inline static thread_local std::vector<std::function<void()>> transaction_undo_;
+    MetaBackend::Ptr backend_;
+    RemovedIdsT removed_;
     MockResourcesT resources_;
+    MockIndexesT indexes_;
+    CommitChainsT chains_;
+    // Per commit type: parents whose commits have all been loaded from the backend
+    std::array<std::unordered_set<ID_TYPE>, std::tuple_size<MockResourcesT>::value> chained_parents_;
     MockIDST ids_;
     std::map<std::string, CollectionPtr> name_collections_;
-    std::unordered_map<std::type_index, std::function<ID_TYPE(std::any const&)>> any_flush_vistors_;
 };
 
 
@@ -13,6 +13,7 @@
 #include "Resources.h"
 #include "ScopedResource.h"
 #include "ResourceTypes.h"
+#include "utils/PersistentMap.h"
 #include <map>
 #include <vector>
 #include <set>
@@ -39,12 +40,18 @@ using PartitionCommitScopedT = ScopedResource<PartitionCommit>;
 using PartitionsT = std::map<ID_TYPE, PartitionScopedT>;
 using PartitionCommitsT = std::map<ID_TYPE, PartitionCommitScopedT>;
 
+// Segment level containers may hold 100k+ entries per snapshot. They are persistent maps so
+// that consecutive snapshot versions share all untouched nodes
+template <typename KeyT, typename ValueT>
+using PersistentMapT = server::PersistentMap<KeyT, ValueT>;
+using IdMapT = PersistentMapT<ID_TYPE, ID_TYPE>;
+
 using SegmentScopedT = ScopedResource<Segment>;
 using SegmentCommitScopedT = ScopedResource<SegmentCommit>;
 using SegmentFileScopedT = ScopedResource<SegmentFile>;
-using SegmentsT = std::map<ID_TYPE, SegmentScopedT>;
-using SegmentCommitsT = std::map<ID_TYPE, SegmentCommitScopedT>;
-using SegmentFilesT = std::map<ID_TYPE, SegmentFileScopedT>;
+using SegmentsT = PersistentMapT<ID_TYPE, SegmentScopedT>;
+using SegmentCommitsT = PersistentMapT<ID_TYPE, SegmentCommitScopedT>;
+using SegmentFilesT = PersistentMapT<ID_TYPE, SegmentFileScopedT>;
 
 } // snapshot
 } // engine
@@ -0,0 +1,210 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include "WriteAheadLog.h"
+#include "Checkpoint.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <iostream>
+#include <vector>
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+static const size_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+WriteAheadLog::~WriteAheadLog() {
+    Close();
+}
+
+uint32_t
+WriteAheadLog::Crc32(const char* data, size_t size) {
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+bool
+WriteAheadLog::Open(const std::string& path, const RecordHandlerT& handler) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (fd_ >= 0) return false;
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        std::cerr << "Failed to open WAL " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    std::string content(st.st_size, '\0');
+    size_t read_size = 0;
+    while (read_size < content.size()) {
+        auto n = ::pread(fd_, &content[read_size], content.size() - read_size, read_size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        read_size += n;
+    }
+
+    uint64_t offset = 0;
+    while (offset + RECORD_HEADER_SIZE <= read_size) {
+        uint32_t size, crc;
+        memcpy(&size, content.data() + offset, sizeof(size));
+        memcpy(&crc, content.data() + offset + sizeof(size), sizeof(crc));
+        auto payload = content.data() + offset + RECORD_HEADER_SIZE;
+        if (offset + RECORD_HEADER_SIZE + size > read_size) break;
+        if (Crc32(payload, size) != crc) break;
+        if (!handler(std::string(payload, size))) {
+            std::cerr << "Failed to replay WAL record at offset " << offset << std::endl;
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        offset += RECORD_HEADER_SIZE + size;
+    }
+
+    if (offset < static_cast<uint64_t>(st.st_size)) {
+        std::cout << "WAL " << path << ": dropping " << st.st_size - offset << " bytes of torn tail" << std::endl;
+        if (ftruncate(fd_, offset) != 0 || fsync(fd_) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+    }
+    offset_ = offset;
+    path_ = path;
+    return true;
+}
+
+bool
+WriteAheadLog::WriteAll(const char* data, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        auto n = ::pwrite(fd_, data + written, size - written, offset_ + written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        written += n;
+    }
+    return true;
+}
+
+bool
+WriteAheadLog::Append(const std::string& record) {
+    std::string frame;
+    frame.reserve(RECORD_HEADER_SIZE + record.size());
+    uint32_t size = record.size();
+    uint32_t crc = Crc32(record.data(), record.size());
+    frame.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    frame.append(reinterpret_cast<const char*>(&crc), sizeof(crc));
+    frame.append(record);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (fd_ < 0) return false;
+    if (!WriteAll(frame.data(), frame.size()) || fdatasync(fd_) != 0) {
+        std::cerr << "Failed to append WAL record: " << strerror(errno) << std::endl;
+        // Do not leave a partial record in front of the next one
+        if (ftruncate(fd_, offset_) != 0) {
+            std::cerr << "Failed to truncate WAL: " << strerror(errno) << std::endl;
+        }
+        return false;
+    }
+    offset_ += frame.size();
+    return true;
+}
+
+uint64_t
+WriteAheadLog::Size() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return offset_;
+}
+
+bool
+WriteAheadLog::DropPrefix(uint64_t offset) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (fd_ < 0 || offset > offset_) return false;
+    if (offset == 0) return true;
+
+    std::string tail(offset_ - offset, '\0');
+    size_t read_size = 0;
+    while (read_size < tail.size()) {
+        auto n = ::pread(fd_, &tail[read_size], tail.size() - read_size, offset + read_size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        read_size += n;
+    }
+
+    auto tmp_path = path_ + ".tmp";
+    auto fd = ::open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    size_t written = 0;
+    while (written < tail.size()) {
+        auto n = ::pwrite(fd, tail.data() + written, tail.size() - written, written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += n;
+    }
+    if (written < tail.size() || fsync(fd) != 0 || ::rename(tmp_path.c_str(), path_.c_str()) != 0) {
+        std::cerr << "Failed to compact WAL " << path_ << ": " << strerror(errno) << std::endl;
+        ::close(fd);
+        ::unlink(tmp_path.c_str());
+        return false;
+    }
+    ::close(fd_);
+    fd_ = fd;
+    offset_ = tail.size();
+    if (!CheckpointFile::SyncParentDir(path_)) {
+        std::cerr << "Failed to sync WAL directory of " << path_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void
+WriteAheadLog::Close() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (fd_ < 0) return;
+    ::close(fd_);
+    fd_ = -1;
+    offset_ = 0;
+}
+
+bool
+WriteAheadLog::IsOpen() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return fd_ >= 0;
+}
+
+} // snapshot
+} // engine
+} // milvus
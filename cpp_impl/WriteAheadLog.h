@@ -0,0 +1,62 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+
+namespace milvus {
+namespace engine {
+namespace snapshot {
+
+// Append-only log of opaque records. Each record is framed as [size:u32][crc32:u32][payload]
+// and is fsync'ed before Append returns.
+class WriteAheadLog {
+public:
+    using RecordHandlerT = std::function<bool(const std::string& record)>;
+
+    WriteAheadLog() = default;
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    ~WriteAheadLog();
+
+    // Open or create the log and pass every intact record to `handler` in order. A torn or
+    // corrupt tail, i.e. a crash during Append, is cut off
+    bool Open(const std::string& path, const RecordHandlerT& handler);
+
+    bool Append(const std::string& record);
+
+    // Bytes of intact records in the log
+    uint64_t Size() const;
+
+    // Drop everything before `offset`, i.e. the records a checkpoint has absorbed. The remaining
+    // records are copied to a new log that atomically replaces the old one
+    bool DropPrefix(uint64_t offset);
+
+    void Close();
+
+    bool IsOpen() const;
+
+    static uint32_t Crc32(const char* data, size_t size);
+
+private:
+    bool WriteAll(const char* data, size_t size);
+
+    mutable std::mutex mutex_;
+    std::string path_;
+    int fd_ = -1;
+    uint64_t offset_ = 0;
+};
+
+} // snapshot
+} // engine
+} // milvus
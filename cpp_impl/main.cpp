@@ -10,6 +10,7 @@
 #include "CompoundOperations.h"
 #include "ResourceHolders.h"
 #include "OperationExecutor.h"
+#include "Reclaimer.h"
 
 using namespace std;
 using namespace milvus::engine::snapshot;
@@ -52,7 +53,11 @@ schema::CollectionSchemaPB proto_lab() {
 
 int main() {
     auto& EXECTOR = OperationExecutor::GetInstance();
-    EXECTOR.Start();
+    EXECTOR.Start(4);
+    auto& RECLAIMER = Reclaimer::GetInstance();
+    RECLAIMER.Start();
+    auto& SNAPSHOT_GC = SnapshotGC::GetInstance();
+    SNAPSHOT_GC.Start();
     Store::GetInstance().Mock();
     auto& sss = Snapshots::GetInstance();
     auto ss_holder = sss.GetHolder("c_1");
@@ -161,6 +166,9 @@ int main() {
     /*     std::cout << "Partition id=" << id << std::endl; */
     /* } */
 
+    // Pending reclamation still pushes hard delete operations
+    SNAPSHOT_GC.Stop();
+    RECLAIMER.Stop();
     EXECTOR.Stop();
 
     return 0;
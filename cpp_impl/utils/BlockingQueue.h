@@ -18,6 +18,7 @@
 #pragma once
 
 #include <assert.h>
+#include <chrono>
 #include <condition_variable>
 #include <iostream>
 #include <queue>
@@ -43,6 +44,10 @@ class BlockingQueue {
     T
     Take();
 
+    // Take with a deadline, a zero timeout only takes what is already queued
+    bool
+    TryTake(T& task, const std::chrono::microseconds& timeout);
+
     T
     Front();
 
@@ -42,6 +42,20 @@ BlockingQueue<T>::Take() {
     return front;
 }
 
+template <typename T>
+bool
+BlockingQueue<T>::TryTake(T& task, const std::chrono::microseconds& timeout) {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (!empty_.wait_for(lock, timeout, [this] { return !queue_.empty(); })) {
+        return false;
+    }
+
+    task = queue_.front();
+    queue_.pop();
+    full_.notify_all();
+    return true;
+}
+
 template <typename T>
 size_t
 BlockingQueue<T>::Size() {
@@ -0,0 +1,72 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+namespace milvus {
+namespace server {
+
+// Ordered set kept in one sorted vector: 8 bytes per id instead of a tree node, and a copy is a
+// single contiguous allocation. Single inserts and erases shift the tail, so edit sets that change
+// more than one key with Edit, which applies all changes in one merge pass.
+template <typename KeyT, typename CompareT = std::less<KeyT>>
+class FlatSet {
+ public:
+    using key_type = KeyT;
+    using value_type = KeyT;
+    using const_iterator = typename std::vector<KeyT>::const_iterator;
+    using iterator = const_iterator;
+    using const_reverse_iterator = typename std::vector<KeyT>::const_reverse_iterator;
+
+    FlatSet() = default;
+    FlatSet(std::initializer_list<KeyT> init);
+    template <typename InputIt>
+    FlatSet(InputIt first, InputIt last);
+
+    size_t size() const { return keys_.size(); }
+    bool empty() const { return keys_.empty(); }
+    void clear() { keys_.clear(); }
+    void reserve(size_t n) { keys_.reserve(n); }
+
+    const_iterator begin() const { return keys_.begin(); }
+    const_iterator end() const { return keys_.end(); }
+    const_reverse_iterator rbegin() const { return keys_.rbegin(); }
+    const_reverse_iterator rend() const { return keys_.rend(); }
+
+    const_iterator find(const KeyT& key) const;
+    size_t count(const KeyT& key) const { return find(key) != end() ? 1 : 0; }
+
+    std::pair<const_iterator, bool> insert(const KeyT& key);
+    size_t erase(const KeyT& key);
+
+    // Remove `removed` and add `added` in one pass. Neither needs to be sorted
+    void Edit(std::vector<KeyT> removed, std::vector<KeyT> added);
+
+    bool operator==(const FlatSet& o) const { return keys_ == o.keys_; }
+    bool operator!=(const FlatSet& o) const { return keys_ != o.keys_; }
+
+ private:
+    void Normalize(std::vector<KeyT>& keys) const;
+
+    std::vector<KeyT> keys_;
+};
+
+} // server
+} // milvus
+
+#include "./FlatSet.inl"
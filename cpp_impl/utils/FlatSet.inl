@@ -0,0 +1,95 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+namespace milvus {
+namespace server {
+
+template <typename KeyT, typename CompareT>
+FlatSet<KeyT, CompareT>::FlatSet(std::initializer_list<KeyT> init) : keys_(init) {
+    Normalize(keys_);
+}
+
+template <typename KeyT, typename CompareT>
+template <typename InputIt>
+FlatSet<KeyT, CompareT>::FlatSet(InputIt first, InputIt last) : keys_(first, last) {
+    Normalize(keys_);
+}
+
+template <typename KeyT, typename CompareT>
+void
+FlatSet<KeyT, CompareT>::Normalize(std::vector<KeyT>& keys) const {
+    CompareT less;
+    std::sort(keys.begin(), keys.end(), less);
+    keys.erase(std::unique(keys.begin(), keys.end(),
+                           [&](const KeyT& l, const KeyT& r) { return !less(l, r) && !less(r, l); }),
+               keys.end());
+}
+
+template <typename KeyT, typename CompareT>
+typename FlatSet<KeyT, CompareT>::const_iterator
+FlatSet<KeyT, CompareT>::find(const KeyT& key) const {
+    CompareT less;
+    auto it = std::lower_bound(keys_.begin(), keys_.end(), key, less);
+    if (it == keys_.end() || less(key, *it)) return keys_.end();
+    return it;
+}
+
+template <typename KeyT, typename CompareT>
+std::pair<typename FlatSet<KeyT, CompareT>::const_iterator, bool>
+FlatSet<KeyT, CompareT>::insert(const KeyT& key) {
+    CompareT less;
+    auto it = std::lower_bound(keys_.begin(), keys_.end(), key, less);
+    if (it != keys_.end() && !less(key, *it)) return {it, false};
+    it = keys_.insert(it, key);
+    return {it, true};
+}
+
+template <typename KeyT, typename CompareT>
+size_t
+FlatSet<KeyT, CompareT>::erase(const KeyT& key) {
+    auto it = find(key);
+    if (it == keys_.end()) return 0;
+    keys_.erase(it);
+    return 1;
+}
+
+template <typename KeyT, typename CompareT>
+void
+FlatSet<KeyT, CompareT>::Edit(std::vector<KeyT> removed, std::vector<KeyT> added) {
+    CompareT less;
+    Normalize(removed);
+    Normalize(added);
+
+    std::vector<KeyT> keys;
+    keys.reserve(keys_.size() + added.size());
+    auto r = removed.begin();
+    auto a = added.begin();
+    for (auto& key : keys_) {
+        while (a != added.end() && less(*a, key)) {
+            keys.push_back(*a++);
+        }
+        while (r != removed.end() && less(*r, key)) {
+            ++r;
+        }
+        bool is_removed = r != removed.end() && !less(key, *r);
+        bool is_added = a != added.end() && !less(key, *a);
+        if (is_added) ++a;
+        // A key both removed and added stays
+        if (!is_removed || is_added) keys.push_back(key);
+    }
+    keys.insert(keys.end(), a, added.end());
+    keys_.swap(keys);
+}
+
+} // server
+} // milvus
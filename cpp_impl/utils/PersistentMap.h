@@ -0,0 +1,114 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace milvus {
+namespace server {
+
+// Ordered map with structural sharing. Nodes are immutable and every update copies only the
+// path from the root to the touched node, so copying a map is O(1) and two versions that differ
+// by N updates share all but O(N log n) nodes.
+// Implemented as a treap whose priorities are derived from the key hash, which makes the shape
+// a function of the key set alone.
+template <typename KeyT, typename ValueT, typename CompareT = std::less<KeyT>>
+class PersistentMap {
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+ public:
+    using key_type = KeyT;
+    using mapped_type = ValueT;
+    using value_type = std::pair<const KeyT, ValueT>;
+
+    class const_iterator {
+     public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = PersistentMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        const_iterator() = default;
+
+        reference operator*() const { return stack_.back()->kv; }
+        pointer operator->() const { return &stack_.back()->kv; }
+
+        const_iterator& operator++();
+        const_iterator operator++(int) { auto tmp = *this; ++(*this); return tmp; }
+
+        bool operator==(const const_iterator& o) const {
+            if (stack_.empty() || o.stack_.empty()) return stack_.empty() == o.stack_.empty();
+            return stack_.back() == o.stack_.back();
+        }
+        bool operator!=(const const_iterator& o) const { return !(*this == o); }
+
+     private:
+        friend class PersistentMap;
+        void PushLeft(const Node* node);
+
+        std::vector<const Node*> stack_;
+    };
+    using iterator = const_iterator;
+
+    PersistentMap() = default;
+    PersistentMap(std::initializer_list<value_type> init);
+
+    size_t size() const { return root_ ? root_->size : 0; }
+    bool empty() const { return !root_; }
+    void clear() { root_.reset(); }
+
+    const_iterator begin() const;
+    const_iterator end() const { return const_iterator(); }
+    const_iterator find(const KeyT& key) const;
+    size_t count(const KeyT& key) const { return Lookup(key) ? 1 : 0; }
+    const ValueT& at(const KeyT& key) const;
+
+    void insert_or_assign(const KeyT& key, const ValueT& value);
+    size_t erase(const KeyT& key);
+
+    // True when both maps are the same version, i.e. share the same root
+    bool SharesRoot(const PersistentMap& o) const { return root_ == o.root_; }
+
+ private:
+    struct Node {
+        value_type kv;
+        uint64_t priority;
+        size_t size;
+        NodePtr left;
+        NodePtr right;
+    };
+
+    static uint64_t Priority(const KeyT& key);
+    static NodePtr MakeNode(const value_type& kv, uint64_t priority, NodePtr left, NodePtr right);
+    static NodePtr Assign(const NodePtr& node, const KeyT& key, const ValueT& value);
+    static NodePtr Insert(const NodePtr& node, const value_type& kv, uint64_t priority);
+    static NodePtr Erase(const NodePtr& node, const KeyT& key);
+    static void Split(const NodePtr& node, const KeyT& key, NodePtr& left, NodePtr& right);
+    static NodePtr Merge(const NodePtr& left, const NodePtr& right);
+
+    const Node* Lookup(const KeyT& key) const;
+
+    NodePtr root_;
+};
+
+} // server
+} // milvus
+
+#include "./PersistentMap.inl"
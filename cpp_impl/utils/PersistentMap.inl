@@ -0,0 +1,206 @@
+// Copyright (C) 2019-2020 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <assert.h>
+
+namespace milvus {
+namespace server {
+
+template <typename KeyT, typename ValueT, typename CompareT>
+void
+PersistentMap<KeyT, ValueT, CompareT>::const_iterator::PushLeft(const Node* node) {
+    while (node) {
+        stack_.push_back(node);
+        node = node->left.get();
+    }
+}
+
+template <typename KeyT, typename ValueT, typename CompareT>
+typename PersistentMap<KeyT, ValueT, CompareT>::const_iterator&
+PersistentMap<KeyT, ValueT, CompareT>::const_iterator::operator++() {
+    auto node = stack_.back();
+    stack_.pop_back();
+    PushLeft(node->right.get());
+    return *this;
+}
+
+template <typename KeyT, typename ValueT, typename CompareT>
+PersistentMap<KeyT, ValueT, CompareT>::PersistentMap(std::initializer_list<value_type> init) {
+    for (auto& kv : init) {
+        insert_or_assign(kv.first, kv.second);
+    }
+}
+
+template <typename KeyT, typename ValueT, typename CompareT>
+typename PersistentMap<KeyT, ValueT, CompareT>::const_iterator
+PersistentMap<KeyT, ValueT, CompareT>::begin() const {
+    const_iterator it;
+    it.PushLeft(root_.get());
+    return it;
+}
+
+template <typename KeyT, typename ValueT, typename CompareT>
+typename PersistentMap<KeyT, ValueT, CompareT>::const_iterator
+PersistentMap<KeyT, ValueT, CompareT>::find(const KeyT& key) const {
+    // The stack keeps every ancestor we descended left from, i.e. the pending in-order successors
+    const_iterator it;
+    CompareT less;
+    auto node = root_.get();
+    while (node) {
+        if (less(key, node->kv.first)) {
+            it.stack_.push_back(node);
+            node = node->left.get();
+        } else if (less(node->kv.first, key)) {
+            node = node->right.get();
+        } else {
+            it.stack_.push_back(node);
+            return it;
+        }
+    }
+    return end();
+}
+
+template <typename KeyT, typename ValueT, typename CompareT>
+const ValueT&
+PersistentMap<KeyT, ValueT, CompareT>::at(const KeyT& key) const {
+    auto node = Lookup(key);
+    assert(node);
+    return node->kv.second;
+}
+
+template <typename KeyT, typename ValueT, typename CompareT>
+void
+PersistentMap<KeyT, ValueT, CompareT>::insert_or_assign(const KeyT& key, const ValueT& value) {
+    if (Lookup(key)) {
+        root_ = Assign(root_, key, value);
+    } else {
+        root_ = Insert(root_, value_type(key, value), Priority(key));
+    }
+}
+
+template <typename KeyT, typename ValueT, typename CompareT>
+size_t
+PersistentMap<KeyT, ValueT, CompareT>::erase(const KeyT& key) {
+    if (!Lookup(key)) return 0;
+    root_ = Erase(root_, key);
+    return 1;
+}
+
+template <typename KeyT, typename ValueT, typename CompareT>
+const typename PersistentMap<KeyT, ValueT, CompareT>::Node*
+PersistentMap<KeyT, ValueT, CompareT>::Lookup(const KeyT& key) const {
+    CompareT less;
+    auto node = root_.get();
+    while (node) {
+        if (less(key, node->kv.first)) {
+            node = node->left.get();
+        } else if (less(node->kv.first, key)) {
+            node = node->right.get();
+        } else {
+            return node;
+        }
+    }
+    return nullptr;
+}
+
+template <typename KeyT, typename ValueT, typename CompareT>
+uint64_t
+PersistentMap<KeyT, ValueT, CompareT>::Priority(const KeyT& key) {
+    // splitmix64 finalizer: std::hash of integers is the identity
+    uint64_t x = std::hash<KeyT>()(key);
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+template <typename KeyT, typename ValueT, typename CompareT>
+typename PersistentMap<KeyT, ValueT, CompareT>::NodePtr
+PersistentMap<KeyT, ValueT, CompareT>::MakeNode(const value_type& kv, uint64_t priority,
+        NodePtr left, NodePtr right) {
+    size_t size = 1 + (left ? left->size : 0) + (right ? right->size : 0);
+    return std::make_shared<const Node>(Node{kv, priority, size, std::move(left), std::move(right)});
+}
+
+template <typename KeyT, typename ValueT, typename CompareT>
+typename PersistentMap<KeyT, ValueT, CompareT>::NodePtr
+PersistentMap<KeyT, ValueT, CompareT>::Assign(const NodePtr& node, const KeyT& key, const ValueT& value) {
+    CompareT less;
+    if (less(key, node->kv.first)) {
+        return MakeNode(node->kv, node->priority, Assign(node->left, key, value), node->right);
+    } else if (less(node->kv.first, key)) {
+        return MakeNode(node->kv, node->priority, node->left, Assign(node->right, key, value));
+    }
+    return MakeNode(value_type(key, value), node->priority, node->left, node->right);
+}
+
+template <typename KeyT, typename ValueT, typename CompareT>
+typename PersistentMap<KeyT, ValueT, CompareT>::NodePtr
+PersistentMap<KeyT, ValueT, CompareT>::Insert(const NodePtr& node, const value_type& kv, uint64_t priority) {
+    if (!node) {
+        return MakeNode(kv, priority, nullptr, nullptr);
+    }
+    if (priority > node->priority) {
+        NodePtr left, right;
+        Split(node, kv.first, left, right);
+        return MakeNode(kv, priority, left, right);
+    }
+    if (CompareT()(kv.first, node->kv.first)) {
+        return MakeNode(node->kv, node->priority, Insert(node->left, kv, priority), node->right);
+    }
+    return MakeNode(node->kv, node->priority, node->left, Insert(node->right, kv, priority));
+}
+
+template <typename KeyT, typename ValueT, typename CompareT>
+typename PersistentMap<KeyT, ValueT, CompareT>::NodePtr
+PersistentMap<KeyT, ValueT, CompareT>::Erase(const NodePtr& node, const KeyT& key) {
+    CompareT less;
+    if (less(key, node->kv.first)) {
+        return MakeNode(node->kv, node->priority, Erase(node->left, key), node->right);
+    } else if (less(node->kv.first, key)) {
+        return MakeNode(node->kv, node->priority, node->left, Erase(node->right, key));
+    }
+    return Merge(node->left, node->right);
+}
+
+template <typename KeyT, typename ValueT, typename CompareT>
+void
+PersistentMap<KeyT, ValueT, CompareT>::Split(const NodePtr& node, const KeyT& key, NodePtr& left, NodePtr& right) {
+    if (!node) {
+        left = right = nullptr;
+        return;
+    }
+    if (CompareT()(node->kv.first, key)) {
+        NodePtr rl;
+        Split(node->right, key, rl, right);
+        left = MakeNode(node->kv, node->priority, node->left, rl);
+    } else {
+        NodePtr lr;
+        Split(node->left, key, left, lr);
+        right = MakeNode(node->kv, node->priority, lr, node->right);
+    }
+}
+
+template <typename KeyT, typename ValueT, typename CompareT>
+typename PersistentMap<KeyT, ValueT, CompareT>::NodePtr
+PersistentMap<KeyT, ValueT, CompareT>::Merge(const NodePtr& left, const NodePtr& right) {
+    if (!left) return right;
+    if (!right) return left;
+    if (left->priority > right->priority) {
+        return MakeNode(left->kv, left->priority, left->left, Merge(left->right, right));
+    }
+    return MakeNode(right->kv, right->priority, Merge(left, right->left), right->right);
+}
+
+} // server
+} // milvus